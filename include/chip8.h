@@ -1,12 +1,133 @@
+#pragma once
+
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include "chip8_rng.h"
+#include "chip8_state.h"
+#include "chip8_zobrist.h"
+
+// decode() is inlined into every nextCycle() instantiation so instrumented
+// builds are compared against the same code shape as the plain one.
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CHIP8_INLINE __forceinline
+#define CHIP8_NOINLINE __declspec(noinline)
+inline unsigned chip8LowestBit(uint64_t v) { unsigned long i; _BitScanForward64(&i, v); return (unsigned)i; }
+#else
+#define CHIP8_INLINE inline __attribute__((always_inline))
+#define CHIP8_NOINLINE __attribute__((noinline))
+inline unsigned chip8LowestBit(uint64_t v) { return (unsigned)__builtin_ctzll(v); }   // v != 0
+#endif
+
+/// Error counters kept by the core; diagnostics only, not part of Chip8State
+struct Chip8Faults {
+    unsigned long unknownOpcodes = 0;   // Opcodes decode() does not implement
+    unsigned long stackOverflows = 0;   // CALL with all 16 stack slots in use
+    unsigned long stackUnderflows = 0;  // RET with an empty stack
+    unsigned short lastUnknownOpcode = 0;
+    unsigned short lastUnknownPc = 0;
+};
+
+/// Instrumentation points of the interpreter. Chip8::nextCycle() runs with
+/// these empty hooks, which inline away; profilers derive from this struct
+/// and hide the hooks they need.
+struct Chip8NoHooks {
+    void onFetch(unsigned short, unsigned short) {}                 // (pc, op): before decode
+    void onCall(unsigned short, unsigned short) {}                  // (pc, target): 2nnn
+    void onReturn(unsigned short, unsigned short) {}                // (pc, target): 00EE
+    void onPixel(unsigned, bool) {}                                 // (index, erased): DXYN pixel toggle
+    void onMemoryRead(unsigned short, unsigned, unsigned) {}        // (pc, addr, count): DXYN rows, Fx65; wraps at 4 KB
+    void onMemoryWrite(unsigned short, unsigned, unsigned) {}       // (pc, addr, count): Fx33, Fx55; before the store
+    bool stopAfter(unsigned short) { return false; }                // (next pc): true ends runCycles() early
+};
+
+/// The 4 KB address space of a Chip8. Reads go through one pointer, to this
+/// instance's own copy or to a shared read-only image (a snapshot's memory,
+/// see Chip8::share and Chip8::unpark), so they never look up a page. The
+/// first store into a shared image copies it (copy-on-write); instances
+/// running one ROM that never store hold no memory of their own.
+class Chip8Memory {
+    public:
+        static constexpr unsigned SIZE = 4096;
+
+        Chip8Memory() = default;
+        ~Chip8Memory(){ delete own; }
+
+        Chip8Memory(const Chip8Memory& o){ *this = o; }
+        Chip8Memory& operator=(const Chip8Memory& o){
+            if(this == &o) return *this;
+            if(o.isPrivate()) memcpy(overwrite(), o.image, SIZE);
+            else share(o.image);
+            return *this;
+        }
+
+        Chip8Memory(Chip8Memory&& o) noexcept : image(o.image), own(o.own) {
+            o.image = zero().bytes;
+            o.own = nullptr;
+        }
+        Chip8Memory& operator=(Chip8Memory&& o) noexcept {
+            if(this == &o) return *this;
+            delete own;
+            image = o.image;
+            own = o.own;
+            o.image = zero().bytes;
+            o.own = nullptr;
+            return *this;
+        }
+
+        const unsigned char& operator[](unsigned addr) const { return image[addr]; }
+        const unsigned char* data() const { return image; }
+        bool isPrivate() const { return own && image == own->bytes; }
+        size_t residentBytes() const { return own ? sizeof(Block) : 0; }
+
+        /// Own copy for a store, made on the first one after share()
+        CHIP8_INLINE unsigned char* writable(){
+            if(!isPrivate()) copyOnWrite();
+            return own->bytes;
+        }
+
+        /// Own storage, contents unspecified: for callers that replace all 4 KB
+        unsigned char* overwrite(){
+            if(!own) own = new Block;
+            image = own->bytes;
+            return own->bytes;
+        }
+
+        /// Read from image in place; it must stay unchanged while shared. An
+        /// own buffer is kept for the next copy-on-write (see release()).
+        void share(const unsigned char* shared){
+            image = shared;
+        }
+
+        /// Free the own buffer while sharing
+        void release(){
+            if(isPrivate()) return;
+            delete own;
+            own = nullptr;
+        }
+
+    private:
+        struct alignas(64) Block { unsigned char bytes[SIZE]; };
+
+        static const Block& zero(){ static const Block z = {}; return z; }
+
+        const unsigned char* image = zero().bytes;
+        Block* own = nullptr;
+
+        CHIP8_NOINLINE void copyOnWrite(){
+            const unsigned char* from = image;
+            memcpy(overwrite(), from, SIZE);
+        }
+};
 
 class Chip8{
     private:
         //  CPU Specification
         unsigned short opcode;          //operation code
-        unsigned char memory[4096];     //4KB memory 
+        Chip8Memory memory;             //4KB memory, copy-on-write when shared
         unsigned char Reg[16];          //15 registers [V00-V15]; Additional Carry bit
         unsigned short I;               //Index register
         unsigned short pc;              //Program Counter
@@ -19,7 +140,7 @@ class Chip8{
         */
 
         //  Graphics
-        unsigned char gfx[2048];        // 1bit [Black And White], 64x32 = 2048p;
+        alignas(64) unsigned char gfx[2048];        // 1bit [Black And White], 64x32 = 2048p;
         bool drawFlag = false;          // Sets the state to draw in screen
         
 
@@ -33,6 +154,9 @@ class Chip8{
         // Stack Pointer
         unsigned char sp;
 
+        // Random source for Cxkk
+        Chip8Rng rng;
+
         //CHIP8 FONT SET
         unsigned char chip8_fontset[80] =
         { 
@@ -56,8 +180,61 @@ class Chip8{
 
         // Extra variable to control data;
             unsigned int soundPlay = 00;
+            bool verbose = true;            // Console logging (BEEP, OP ERROR); off for headless tools
+            Chip8Faults faults;
+
+        // Incremental Zobrist hashes (chip8_zobrist.h). decode() writes memory only
+        // through writeMemory() and updates zobristGfx on every pixel toggle; bulk
+        // loads call rehash(). Build with CHIP8_HASH_DEBUG to check both against a
+        // full recompute after every instruction.
+        uint64_t zobristMemory = 0;
+        uint64_t zobristGfx = 0;
+
+        // 64-byte pages written since checkpoint() (a gfx page is one 64-pixel
+        // row), so resetTo() copies back only those. The same write paths as the
+        // Zobrist hashes keep them current.
+        uint64_t dirtyMemory = 0;
+        uint32_t dirtyGfx = 0;
+        const Chip8State* dirtyBase = nullptr;      // Checkpoint the masks refer to
+
+        CHIP8_INLINE void writeMemory(unsigned addr, unsigned char value){
+            if(memory[addr] == value) return;           // Fx55 often stores what is already there
+            zobristMemory ^= chip8ZobristByte(addr, memory[addr]) ^ chip8ZobristByte(addr, value);
+            memory.writable()[addr] = value;
+            dirtyMemory |= 1ull << ((addr >> 6) & 63);
+        }
 
-        void decode(unsigned op){
+        void rehash(){
+            zobristMemory = chip8ZobristMemory(memory.data());
+            zobristGfx = chip8ZobristGfx(gfx);
+        }
+
+        /// Everything in s but memory and framebuffer
+        void loadRegisters(const Chip8State& s){
+            memcpy(stack, s.stack, sizeof(stack));
+            memcpy(Reg, s.reg, sizeof(Reg));
+            memcpy(key, s.key, sizeof(key));
+            memcpy(&rng, s.rng, sizeof(rng));
+            I = s.I;
+            pc = s.pc;
+            opcode = s.opcode;
+            sp = s.sp;
+            delay_timer = s.delayTimer;
+            sound_timer = s.soundTimer;
+            drawFlag = s.drawFlag;
+            zobristMemory = s.zobristMemory;
+            zobristGfx = s.zobristGfx;
+        }
+
+        CHIP8_NOINLINE void unknownOpcode(unsigned op){
+            faults.unknownOpcodes++;
+            faults.lastUnknownOpcode = op;
+            faults.lastUnknownPc = pc;
+            if(verbose) printf("OP ERROR: 0x%04X at PC=0x%03X\n", op, pc);
+        }
+
+        template<class Hooks>
+        CHIP8_INLINE void decode(unsigned op, Hooks& hooks){
 
             // Operations
             unsigned short A = op & 0xF000;             // Instruction op
@@ -74,13 +251,17 @@ class Chip8{
                         case 0xE0:                // Graphics buffer clear | CLS
                             for(int i =0; i<2048;i++) 
                                 gfx[i] = 0;
+                            zobristGfx = 0;
+                            dirtyGfx = ~0u;
                             pc+=2;
                             break;
 
                         case 0xEE:                // Return from subroutine | RET
+                            if(sp == 0) faults.stackUnderflows++;
                             sp--;               
-                            pc = stack[sp];
-                            stack[sp]=0;
+                            hooks.onReturn(pc, stack[sp & 15]);
+                            pc = stack[sp & 15];    // Wraps like the batch engine instead of leaving the array
+                            stack[sp & 15]=0;
                             break;
                         
                         default:                    // Default program counter addition
@@ -94,7 +275,9 @@ class Chip8{
                     break;
                 
                 case 0x2000:                        // Increment stack adder | CALL addr
-                    stack[sp] = pc + 2;
+                    hooks.onCall(pc, nnn);
+                    if(sp >= 16) faults.stackOverflows++;
+                    stack[sp & 15] = pc + 2;
                     sp++;
                     pc=nnn;
                     break;
@@ -157,6 +340,9 @@ class Chip8{
                             Reg[0xF] = (Reg[B] & 0x80) >> 7; // MSB before shift
                             Reg[B] <<= 1;
                             break;
+                        default:
+                            unknownOpcode(op);
+                            break;
                     }
                     pc += 2;
                     break;
@@ -180,7 +366,7 @@ class Chip8{
                     break;
 
                 case 0xC000: {                      // Set Vx = random byte AND kk.
-                    unsigned char random_byte = rand() & 0xFF;  // generates a random number from 0 to 255
+                    unsigned char random_byte = rng.next() & 0xFF;  // generates a random number from 0 to 255
                     Reg[B] = random_byte & kk;
                     pc+=2;
                     break;
@@ -203,10 +389,12 @@ class Chip8{
                     unsigned char height = D;
 
                     Reg[0xF] = 0;                               // Clears VF 
+                    hooks.onMemoryRead(pc, I & 0xFFF, height);
 
                     for(int yl = 0 ; yl < height; yl++){        // Draws y line till the sprite reaches height
                         
-                        unsigned char spriteBytes = memory[I + yl];  // Reads sprite from memory
+                        unsigned char spriteBytes = memory[(I + yl) & 0xFFF];  // Reads sprite from memory
+                        dirtyGfx |= 1u << ((y + yl) % 32);
                         
                         for( int xl = 0; xl < 8; xl++){
                                 if((spriteBytes & (0x80 >> xl)) != 0){  // Reads bits left to right
@@ -217,8 +405,10 @@ class Chip8{
                                     if(gfx[index] == 1){        // Collision Detection
                                         Reg[0xF] = 1;           // Carry graphics
                                     }
+                                    hooks.onPixel(index, gfx[index] == 1);
 
                                     gfx[index] ^=1;             // Toggle Pixels
+                                    zobristGfx ^= CHIP8_ZOBRIST_PIXELS.key[index];
                                 }
                         }
                     }
@@ -230,16 +420,20 @@ class Chip8{
                 case 0xE000:
                     switch(op & 0x00FF){
                         case 0x9E:                              // Skip next instruction if key with the value of Vx is pressed | SKP Vx
-                            if(key[Reg[B]])
+                            if(key[Reg[B] & 15])
                                 pc += 4;
                             else pc += 2;
                             break;
                         
                         case 0xA1:                              // Skip next instruction if key with the value of Vx is not pressed | SKNP Vx
-                            if(!key[Reg[B]])
+                            if(!key[Reg[B] & 15])
                                 pc += 4;
                             else pc += 2;
                             break;
+
+                        default:                                // PC stays, as before
+                            unknownOpcode(op);
+                            break;
                     }
                     break;
                 
@@ -284,52 +478,73 @@ class Chip8{
                         
                         case 0x33:{                             // LD B, Vx (BCD)
                             unsigned char value = Reg[B];
-                            memory[I]     = value / 100;
-                            memory[I + 1] = (value / 10) % 10;
-                            memory[I + 2] = value % 10;
+                            hooks.onMemoryWrite(pc, I & 0xFFF, 3);
+                            writeMemory(I & 0xFFF,       value / 100);
+                            writeMemory((I + 1) & 0xFFF, (value / 10) % 10);
+                            writeMemory((I + 2) & 0xFFF, value % 10);
                             pc += 2;
                             break;
                         }
 
                         case 0x55:                              // Store registers V0 through Vx in memory starting at location I 
+                            hooks.onMemoryWrite(pc, I & 0xFFF, B + 1);
                             for(int i=0;i<=B;i++){
-                                memory[I + i] = Reg[i];
+                                writeMemory((I + i) & 0xFFF, Reg[i]);
                             }
                             pc += 2;
                             break;
                         
                         case 0x65:                              // Read registers V0 through Vx from memory starting at location I.
+                            hooks.onMemoryRead(pc, I & 0xFFF, B + 1);
                             for(int i=0;i<=B;i++){
-                                Reg[i] = memory[I+i];
+                                Reg[i] = memory[(I + i) & 0xFFF];
                             }
                             pc += 2;
                             break;
+
+                        default:                                // PC stays, as before
+                            unknownOpcode(op);
+                            break;
                     }
                     break;
                     
 
                 default:
-                    printf("OP ERROR: 0x%04X at PC=0x%03X\n", op, pc);
+                    unknownOpcode(op);
                     pc+=2;
                     break;
             }
         }
 
     public:
+        /// Instructions executed per 60 Hz frame by the frame-based runners
+        static constexpr unsigned CYCLES_PER_FRAME = 11;
+
         /// Create instance
-        Chip8(){
+        Chip8() : Chip8(true) {}
+
+        /// Create instance; a quiet instance never writes to stdout
+        explicit Chip8(bool verboseLog) : verbose(verboseLog) {
+            if(!verbose) return;
             setvbuf(stdout, nullptr, _IONBF, 0);
             puts("Initialized Chip 8");
         }
 
         /// Initialize Emulator
         void init(){
-            
-            // Generate random seed
-            srand(time(nullptr));
+            init((uint64_t)time(nullptr));
+        }
+
+        /// Initialize Emulator with a fixed random seed (reproducible runs)
+        void init(uint64_t seed, Chip8Rng::Algorithm rngAlgorithm = Chip8Rng::PCG32){
+
+            // Seed this instance's generator
+            rng.seed(seed, rngAlgorithm);
+            faults = Chip8Faults();
 
             // Clear Registers
-            for (int i = 0; i < 4096; i++) memory[i] = 0;
+            unsigned char* mem = memory.overwrite();
+            for (int i = 0; i < 4096; i++) mem[i] = 0;
             for (int i = 0; i < 16; i++) Reg[i] = key[i] = 0;
             for (int i = 0; i < 2048; i++) gfx[i] = 0;
             for (int i = 0; i < 16; i++) stack[i] = 0;
@@ -343,29 +558,64 @@ class Chip8{
             sound_timer = 0;                            // Reset sound timer
 
             for (int i=0; i < 80; i++){                 // Fontset size (5 * 16) = 80 bits
-                memory[80 + i]  = chip8_fontset[i];     //Loads Font into the memory after initial 80 bytes
+                mem[80 + i]  = chip8_fontset[i];     //Loads Font into the memory after initial 80 bytes
             }
+            rehash();
+            dirtyBase = nullptr;
         }
 
         /// CPU cycle
         void nextCycle(){
-            opcode = memory[pc] << 8 | memory[pc+1];    // Get bits from program counter's memory, shifts 8 bit, merge with next bits
-            decode(opcode);
+            Chip8NoHooks none;
+            nextCycle(none);
+        }
+
+        /// CPU cycle with instrumentation hooks (see Chip8NoHooks)
+        template<class Hooks>
+        void nextCycle(Hooks& hooks){
+            opcode = memory[pc & 0xFFF] << 8 | memory[(pc + 1) & 0xFFF];   // Get bits from program counter's memory, shifts 8 bit, merge with next bits
+            hooks.onFetch(pc, opcode);
+            decode(opcode, hooks);
+#ifdef CHIP8_HASH_DEBUG
+            if(zobristMemory != chip8ZobristMemory(memory.data()) || zobristGfx != chip8ZobristGfx(gfx)){
+                fprintf(stderr, "Chip8: incremental hash out of sync after 0x%04X at PC=0x%03X\n", opcode, pc);
+                abort();
+            }
+#endif
             
             if(delay_timer > 0 ){
                 --delay_timer;
             }
             if(sound_timer > 0){
                 soundPlay = 01;
-                printf("BEEP\n");
+                if(verbose) printf("BEEP\n");
                 --sound_timer;
             }
         }
 
-        /// Load the program
-        void loadProgram(unsigned char* buf, int size){
+        /// Run a batch of CPU cycles
+        void runCycles(unsigned long count){
+            for(unsigned long i = 0; i < count; i++)
+                nextCycle();
+        }
+
+        /// Run a batch of CPU cycles with instrumentation hooks. Returns the
+        /// cycles run: fewer than count when Hooks::stopAfter() asked to stop.
+        template<class Hooks>
+        unsigned long runCycles(unsigned long count, Hooks& hooks){
+            for(unsigned long i = 0; i < count; i++){
+                nextCycle(hooks);
+                if(hooks.stopAfter(pc)) return i + 1;
+            }
+            return count;
+        }
+
+        /// Load the program. Goes through writeMemory(), so the hash and dirty
+        /// pages stay current: loading after resetTo() costs only the ROM's size.
+        void loadProgram(const unsigned char* buf, int size){
+            if(size > 4096 - 0x200) size = 4096 - 0x200;
             for(int i = 0; i< size; i++){
-                memory[512+i] = buf[i];         //Load the rom's data into memory after inital 512bits
+                writeMemory(512 + i, buf[i]);   //Load the rom's data into memory after inital 512bits
             }
         }
 
@@ -385,18 +635,219 @@ class Chip8{
                 return false;
             }
 
-            size_t read = fread(&memory[0x200], 1, (size_t)size, f);
+            size_t read = fread(memory.writable() + 0x200, 1, (size_t)size, f);
             fclose(f);
+            rehash();
+            dirtyBase = nullptr;
 
             return read == (size_t)size;
         }
 
+        /// Capture the whole machine into a sealed snapshot.
+        /// Pass seal=false for snapshots that are only compared or restored in-process.
+        void saveState(Chip8State& s, bool seal = true) const {
+            memcpy(s.memory, memory.data(), Chip8Memory::SIZE);
+            memcpy(s.gfx, gfx, sizeof(gfx));
+            memcpy(s.stack, stack, sizeof(stack));
+            memcpy(s.reg, Reg, sizeof(Reg));
+            memcpy(s.key, key, sizeof(key));
+            memcpy(s.rng, &rng, sizeof(rng));
+            s.I = I;
+            s.pc = pc;
+            s.opcode = opcode;
+            s.sp = sp;
+            s.delayTimer = delay_timer;
+            s.soundTimer = sound_timer;
+            s.drawFlag = drawFlag;
+            memset(s.padding0, 0, sizeof(s.padding0));
+            s.zobristMemory = zobristMemory;
+            s.zobristGfx = zobristGfx;
+            memset(s.padding, 0, sizeof(s.padding));
+            if(seal) s.seal();
+        }
+
+        /// Restore a snapshot; rejects blobs from another version or with a bad checksum.
+        /// Pass verify=false for blobs this process sealed itself.
+        bool loadState(const Chip8State& s, bool verify = true){
+            if(verify && !s.valid()) return false;
+            memcpy(memory.overwrite(), s.memory, Chip8Memory::SIZE);
+            memcpy(gfx, s.gfx, sizeof(gfx));
+            loadRegisters(s);
+            dirtyBase = nullptr;
+            return true;
+        }
+
+        /// Continue from base like loadState(base, false), but read memory in
+        /// place from base.memory until the first store that changes it. base
+        /// must outlive this instance's use of it (as with Chip8Parked), and
+        /// writes are tracked against it, so resetTo(base) stays cheap.
+        void share(const Chip8State& base){
+            memory.share(base.memory);
+            memory.release();
+            memcpy(gfx, base.gfx, sizeof(gfx));
+            loadRegisters(base);
+            dirtyMemory = 0;
+            dirtyGfx = 0;
+            dirtyBase = &base;
+        }
+
+        /// Snapshot into s (unsealed) and start tracking writes against it
+        void checkpoint(Chip8State& s){
+            saveState(s, false);
+            dirtyMemory = 0;
+            dirtyGfx = 0;
+            dirtyBase = &s;
+        }
+
+        /// Return to the state in s. When s is this instance's latest checkpoint()
+        /// and unchanged since, only the pages written after it are copied back;
+        /// otherwise this is a full loadState(). Fault counters are kept, as with loadState().
+        void resetTo(const Chip8State& s){
+            if(&s != dirtyBase){
+                loadState(s, false);
+                dirtyMemory = 0;
+                dirtyGfx = 0;
+                dirtyBase = &s;
+                return;
+            }
+            if(dirtyMemory){                            // Any store that changed a byte made memory private
+                unsigned char* mem = memory.writable();
+                for(uint64_t m = dirtyMemory; m; m &= m - 1){
+                    unsigned page = chip8LowestBit(m) * 64;
+                    memcpy(mem + page, s.memory + page, 64);
+                }
+            }
+            for(uint32_t m = dirtyGfx; m; m &= m - 1){
+                unsigned page = chip8LowestBit(m) * 64;
+                memcpy(gfx + page, s.gfx + page, 64);
+            }
+            dirtyMemory = 0;
+            dirtyGfx = 0;
+            loadRegisters(s);
+        }
+
+        /// Store this machine in p as the pages that differ from base plus the
+        /// registers. Cheap when base is this instance's checkpoint or the base of
+        /// its last unpark(): only pages written since are compared.
+        void park(Chip8Parked& p, const Chip8State& base) const {
+            const unsigned char* mem = memory.data();
+            uint64_t memoryCandidates = mem == base.memory ? 0 : &base == dirtyBase ? dirtyMemory : ~0ull;
+            uint32_t gfxCandidates = &base == dirtyBase ? dirtyGfx : ~0u;
+            p.base = &base;
+            p.memoryPages = 0;
+            p.gfxPages = 0;
+            p.pages.clear();
+            for(uint64_t m = memoryCandidates; m; m &= m - 1){
+                unsigned page = chip8LowestBit(m);
+                if(!memcmp(mem + page * 64, base.memory + page * 64, 64)) continue;
+                p.memoryPages |= 1ull << page;
+                p.pages.insert(p.pages.end(), mem + page * 64, mem + page * 64 + 64);
+            }
+            for(uint32_t m = gfxCandidates; m; m &= m - 1){
+                unsigned row = chip8LowestBit(m);
+                if(!memcmp(gfx + row * 64, base.gfx + row * 64, 64)) continue;
+                p.gfxPages |= 1u << row;
+                p.pages.insert(p.pages.end(), gfx + row * 64, gfx + row * 64 + 64);
+            }
+            memcpy(p.rng, &rng, sizeof(rng));
+            memcpy(p.stack, stack, sizeof(stack));
+            memcpy(p.reg, Reg, sizeof(Reg));
+            memcpy(p.key, key, sizeof(key));
+            p.I = I;
+            p.pc = pc;
+            p.opcode = opcode;
+            p.sp = sp;
+            p.delayTimer = delay_timer;
+            p.soundTimer = sound_timer;
+            p.drawFlag = drawFlag;
+            p.zobristMemory = zobristMemory;
+            p.zobristGfx = zobristGfx;
+        }
+
+        /// Restore a parked machine. With no stored memory pages it runs on
+        /// p.base's memory in place, as after share(); otherwise it takes a
+        /// private copy (reusing this instance's buffer). Writes are then
+        /// tracked against p.base, so parking again against the same base stays cheap.
+        void unpark(const Chip8Parked& p){
+            const Chip8State& base = *p.base;
+            if(&base == dirtyBase){
+                for(uint32_t m = dirtyGfx; m; m &= m - 1){
+                    unsigned page = chip8LowestBit(m) * 64;
+                    memcpy(gfx + page, base.gfx + page, 64);
+                }
+            }
+            else memcpy(gfx, base.gfx, sizeof(gfx));
+            memory.share(base.memory);
+            const uint8_t* src = p.pages.data();
+            if(p.memoryPages){
+                unsigned char* mem = memory.writable();
+                for(uint64_t m = p.memoryPages; m; m &= m - 1, src += 64)
+                    memcpy(mem + chip8LowestBit(m) * 64, src, 64);
+            }
+            for(uint32_t m = p.gfxPages; m; m &= m - 1, src += 64)
+                memcpy(gfx + chip8LowestBit(m) * 64, src, 64);
+            dirtyMemory = p.memoryPages;
+            dirtyGfx = p.gfxPages;
+            dirtyBase = &base;
+            memcpy(&rng, p.rng, sizeof(rng));
+            memcpy(stack, p.stack, sizeof(stack));
+            memcpy(Reg, p.reg, sizeof(Reg));
+            memcpy(key, p.key, sizeof(key));
+            I = p.I;
+            pc = p.pc;
+            opcode = p.opcode;
+            sp = p.sp;
+            delay_timer = p.delayTimer;
+            sound_timer = p.soundTimer;
+            drawFlag = p.drawFlag;
+            zobristMemory = p.zobristMemory;
+            zobristGfx = p.zobristGfx;
+        }
+
+        /// True when this machine would run exactly like one restored from s: everything
+        /// that feeds later execution matches (opcode and drawFlag are outputs, not inputs).
+        /// Cheap fields first, so a mismatch usually costs a few compares.
+        bool matchesState(const Chip8State& s) const {
+            return pc == s.pc && I == s.I && sp == s.sp
+                && delay_timer == s.delayTimer && sound_timer == s.soundTimer
+                && !memcmp(Reg, s.reg, sizeof(Reg)) && !memcmp(stack, s.stack, sizeof(stack))
+                && !memcmp(key, s.key, sizeof(key)) && !memcmp(&rng, s.rng, sizeof(rng))
+                && !memcmp(gfx, s.gfx, sizeof(gfx)) && !memcmp(memory.data(), s.memory, Chip8Memory::SIZE);
+        }
+
+        /// 64-bit hash of everything matchesState() compares, in O(1): memory and
+        /// framebuffer are hashed incrementally, the small fields when this is called
+        uint64_t stateHash() const {
+            return chip8StateHash(zobristMemory, zobristGfx, Reg, key, stack, I, pc, sp, delay_timer, sound_timer,
+                                  reinterpret_cast<const uint8_t*>(&rng));
+        }
+
+        bool timersIdle() const { return delay_timer == 0 && sound_timer == 0; }   // No countdown pending
+        const Chip8Faults& getFaults() const { return faults; }     // Error counters since init()
         const unsigned char* getGfx() const { return gfx; }         // Get Graphics
+        unsigned char readMemory(unsigned addr) const { return memory[addr & 0xFFF]; }
+        size_t residentBytes() const { return sizeof(*this) + memory.residentBytes(); }   // Shared images not included
+        unsigned char readRegister(unsigned x) const { return Reg[x & 15]; }
+        const unsigned char* getRegisters() const { return Reg; }   // V0-VF
+        unsigned short getPC() const { return pc; }                 // Address of the next fetch
+        unsigned short getIndex() const { return I; }
+        unsigned char getStackPointer() const { return sp; }
         bool shouldDraw() const { return drawFlag; }                // Get Draw Flag
         void clearDrawFlag() { drawFlag = false; }                  // Set Draw Flag to false
+        void setVerbose(bool on) { verbose = on; }                  // Quiet speculative runs (no BEEP/OP ERROR)
 
         void setKey(unsigned idx, unsigned char pressed) {          // Key Press (CHATGPT FOR NOW, WILL REPLACE LATER)
             if (idx < 16) key[idx] = pressed;
         }
+
+        void setKeys(unsigned short mask) {                         // Whole keypad, bit i = key i
+            for (int i = 0; i < 16; i++) key[i] = (mask >> i) & 1;
+        }
+
+        unsigned short getKeys() const {
+            unsigned short mask = 0;
+            for (int i = 0; i < 16; i++) if (key[i]) mask |= 1 << i;
+            return mask;
+        }
 };
 
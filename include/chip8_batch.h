@@ -0,0 +1,509 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "chip8.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CHIP8_BATCH_GATHER 1
+#endif
+
+/// Lockstep interpreter for many instances ("lanes") of the same ROM.
+/// State is stored as structure-of-arrays: every register, PC, timer, stack
+/// slot, key and memory byte is a row indexed by lane, so lane l's V3 is
+/// reg[3 * stride + l] and its byte at address a is memory[a * stride + l].
+/// Framebuffers stay one per lane, since DXYN touches a single lane's pixels.
+///
+/// step() executes one instruction on every lane. Opcodes are fetched for all
+/// lanes (AVX2 gathers when the CPU has them), lanes are grouped by opcode, and
+/// each group runs one handler with x, y, kk and nnn fixed, so its loop over
+/// lanes is plain array code the compiler vectorizes (AVX-512 masked stores
+/// included, when built for it). When all lanes agree on the opcode, the usual
+/// case for lockstep runs, the group is the contiguous range of all lanes.
+///
+/// Per-lane semantics match Chip8::decode, including how both wrap indices that
+/// would leave the arrays (PC or I past 4 KB, sp outside 0-15, a key index above 15).
+class Chip8Batch {
+    public:
+        /// Create `lanes` instances; call init() before running
+        explicit Chip8Batch(unsigned lanes)
+            : n(lanes), stride((lanes + 31) & ~31u),
+              memory(4096 * (size_t)stride + 4), gfx(2048 * (size_t)stride),
+              reg(16 * (size_t)stride), key(16 * (size_t)stride), stack(16 * (size_t)stride),
+              pc(stride), I(stride), opcode(stride),
+              sp(stride), delayTimer(stride), soundTimer(stride), drawFlag(stride),
+              rng(stride), order(stride), groupOf(stride), slot(65536),
+              groupOp(stride), groupCount(stride), groupStart(stride) {
+#ifdef CHIP8_BATCH_GATHER
+            gather = gatherSupported();
+#endif
+        }
+
+        /// Reset every lane as Chip8::init(seed + lane, rngAlgorithm) would
+        void init(uint64_t seed, Chip8Rng::Algorithm rngAlgorithm = Chip8Rng::PCG32){
+            std::unique_ptr<Chip8State> s(new Chip8State);     // Per call: batches may init on several threads
+            Chip8 proto(false);
+            proto.init(seed, rngAlgorithm);
+            proto.saveState(*s);
+            for(unsigned l = 0; l < n; l++){
+                loadState(l, *s, false);
+                rng[l].seed(seed + l, rngAlgorithm);
+            }
+            executed = 0;
+        }
+
+        /// Load the same program into every lane at 0x200
+        void loadProgram(const unsigned char* buf, int size){
+            if(size > 4096 - 0x200) size = 4096 - 0x200;
+            for(int i = 0; i < size; i++)
+                memset(&memory[(size_t)(0x200 + i) * stride], buf[i], n);
+        }
+
+        /// CPU cycle on every lane. Out of line on purpose: inlined into a
+        /// caller's loop, GCC 12 lost most of the vectorized lane loops (3-4x slower).
+        CHIP8_NOINLINE void step(){
+            bool uniform = fetch();
+            if(uniform){
+                execute(opcode[0], AllLanes{ n });
+            }
+            else{
+                // Counting sort of lanes by opcode; slot[] maps an opcode to its group + 1
+                unsigned groups = 0;
+                for(unsigned l = 0; l < n; l++){
+                    uint32_t& g = slot[opcode[l]];
+                    if(!g){
+                        groupOp[groups] = opcode[l];
+                        groupCount[groups] = 0;
+                        g = ++groups;
+                    }
+                    groupOf[l] = g - 1;
+                    groupCount[g - 1]++;
+                }
+                unsigned start = 0;
+                for(unsigned g = 0; g < groups; g++){
+                    groupStart[g] = start;
+                    start += groupCount[g];
+                }
+                for(unsigned l = 0; l < n; l++)
+                    order[groupStart[groupOf[l]]++] = l;
+                for(unsigned g = 0; g < groups; g++){
+                    unsigned count = groupCount[g];
+                    const uint32_t* lanesOf = &order[groupStart[g] - count];
+                    if(count == 1) execute(groupOp[g], OneLane{ lanesOf[0] });
+                    else execute(groupOp[g], LaneList{ lanesOf, count });
+                    slot[groupOp[g]] = 0;
+                }
+            }
+
+            // Byte stores may alias members, so the bound is kept in a local
+            const unsigned count = n;
+            uint8_t* dt = delayTimer.data();
+            uint8_t* st = soundTimer.data();
+            for(unsigned l = 0; l < count; l++) dt[l] -= dt[l] != 0;
+            for(unsigned l = 0; l < count; l++) st[l] -= st[l] != 0;
+            executed += n;
+        }
+
+        /// Run a batch of CPU cycles on every lane
+        void runCycles(unsigned long count){
+            for(unsigned long i = 0; i < count; i++)
+                step();
+        }
+
+        unsigned lanes() const { return n; }
+        unsigned long long instructions() const { return executed; }    // Summed over lanes
+        void setGather(bool on) { gather = on && gatherSupported(); }   // For comparisons
+        bool gatherEnabled() const { return gather; }
+
+        void setKeys(unsigned lane, unsigned short mask){                // Bit i = key i
+            for(int i = 0; i < 16; i++) key[i * (size_t)stride + lane] = (mask >> i) & 1;
+        }
+
+        bool shouldDraw(unsigned lane) const { return drawFlag[lane]; }
+        void clearDrawFlag(unsigned lane) { drawFlag[lane] = 0; }
+
+        /// Copy one lane's framebuffer out (2048 bytes, row-major like Chip8::getGfx)
+        void copyGfx(unsigned lane, unsigned char* out) const {
+            memcpy(out, &gfx[lane * (size_t)2048], 2048);
+        }
+
+        const unsigned char* getGfx(unsigned lane) const { return &gfx[lane * (size_t)2048]; }
+        unsigned char readMemory(unsigned lane, unsigned addr) const { return memory[(addr & 0xFFF) * (size_t)stride + lane]; }
+
+        /// Capture one lane into a sealed snapshot, comparable with Chip8::saveState
+        void saveState(unsigned lane, Chip8State& s) const {
+            for(size_t a = 0; a < 4096; a++) s.memory[a] = memory[a * stride + lane];
+            copyGfx(lane, s.gfx);
+            for(size_t i = 0; i < 16; i++){
+                s.stack[i] = stack[i * stride + lane];
+                s.reg[i] = reg[i * stride + lane];
+                s.key[i] = key[i * stride + lane];
+            }
+            memcpy(s.rng, &rng[lane], sizeof(Chip8Rng));
+            s.I = I[lane];
+            s.pc = pc[lane];
+            s.opcode = opcode[lane];
+            s.sp = sp[lane];
+            s.delayTimer = delayTimer[lane];
+            s.soundTimer = soundTimer[lane];
+            s.drawFlag = drawFlag[lane];
+            memset(s.padding0, 0, sizeof(s.padding0));
+            s.zobristMemory = chip8ZobristMemory(s.memory);
+            s.zobristGfx = chip8ZobristGfx(s.gfx);
+            memset(s.padding, 0, sizeof(s.padding));
+            s.seal();
+        }
+
+        /// Restore one lane from a snapshot (e.g. taken from a Chip8)
+        bool loadState(unsigned lane, const Chip8State& s, bool verify = true){
+            if(verify && !s.valid()) return false;
+            for(size_t a = 0; a < 4096; a++) memory[a * stride + lane] = s.memory[a];
+            memcpy(&gfx[lane * (size_t)2048], s.gfx, 2048);
+            for(size_t i = 0; i < 16; i++){
+                stack[i * stride + lane] = s.stack[i];
+                reg[i * stride + lane] = s.reg[i];
+                key[i * stride + lane] = s.key[i];
+            }
+            memcpy(&rng[lane], s.rng, sizeof(Chip8Rng));
+            I[lane] = s.I;
+            pc[lane] = s.pc;
+            opcode[lane] = s.opcode;
+            sp[lane] = s.sp;
+            delayTimer[lane] = s.delayTimer;
+            soundTimer[lane] = s.soundTimer;
+            drawFlag[lane] = s.drawFlag;
+            return true;
+        }
+
+    private:
+        struct AllLanes {                   // Lanes 0..n-1, contiguous
+            static constexpr bool ALL = true;
+            unsigned n;
+            unsigned size() const { return n; }
+            unsigned operator[](unsigned i) const { return i; }
+        };
+
+        struct OneLane {                    // A group of one: loops fold away
+            static constexpr bool ALL = false;
+            unsigned lane;
+            unsigned size() const { return 1; }
+            unsigned operator[](unsigned) const { return lane; }
+        };
+
+        struct LaneList {                   // One opcode group, ascending lane order
+            static constexpr bool ALL = false;
+            const uint32_t* lane;
+            unsigned n;
+            unsigned size() const { return n; }
+            unsigned operator[](unsigned i) const { return lane[i]; }
+        };
+
+        unsigned n;                         // Lanes
+        unsigned stride;                    // Row length, lanes rounded up to 32
+        std::vector<uint8_t> memory;        // [4096][stride], +4 bytes for 32-bit gathers
+        std::vector<uint8_t> gfx;           // [stride][2048]: only ever touched one lane at a time
+        std::vector<uint8_t> reg;           // [16][stride]
+        std::vector<uint8_t> key;           // [16][stride]
+        std::vector<uint16_t> stack;        // [16][stride]
+        std::vector<uint16_t> pc, I, opcode;
+        std::vector<uint8_t> sp, delayTimer, soundTimer, drawFlag;
+        std::vector<Chip8Rng> rng;
+        unsigned long long executed = 0;
+        bool gather = false;
+
+        // Opcode grouping scratch
+        std::vector<uint32_t> order, groupOf, slot;
+        std::vector<uint16_t> groupOp;
+        std::vector<uint32_t> groupCount, groupStart;
+
+        static bool gatherSupported(){
+#ifdef CHIP8_BATCH_GATHER
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+        }
+
+        /// Load every lane's opcode; true when all lanes fetched the same one
+        bool fetch(){
+            const unsigned n = this->n;
+            const uint16_t* p = pc.data();
+            uint16_t* op = opcode.data();
+            uint16_t pcDiff = 0;
+            for(unsigned l = 0; l < n; l++) pcDiff |= p[l] ^ p[0];
+
+            if(pcDiff == 0){
+                // Same PC everywhere: the two opcode bytes are contiguous rows
+                unsigned a = p[0] & 0xFFF;
+                const uint8_t* hi = &memory[(size_t)a * stride];
+                const uint8_t* lo = &memory[(size_t)((a + 1) & 0xFFF) * stride];
+                for(unsigned l = 0; l < n; l++) op[l] = hi[l] << 8 | lo[l];
+            }
+            else{
+                unsigned l = 0;
+#ifdef CHIP8_BATCH_GATHER
+                if(gather) l = fetchGather();
+#endif
+                for(; l < n; l++){
+                    unsigned a = p[l] & 0xFFF;
+                    op[l] = memory[(size_t)a * stride + l] << 8 | memory[(size_t)((a + 1) & 0xFFF) * stride + l];
+                }
+            }
+
+            uint16_t diff = 0;
+            for(unsigned l = 0; l < n; l++) diff |= op[l] ^ op[0];
+            return diff == 0;
+        }
+
+#ifdef CHIP8_BATCH_GATHER
+        /// Eight lanes per iteration: two dword gathers at byte offsets, low byte kept
+        __attribute__((target("avx2")))
+        unsigned fetchGather(){
+            const __m256i laneStep = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+            const __m256i stride8 = _mm256_set1_epi32((int)stride);
+            const __m256i mask12 = _mm256_set1_epi32(0xFFF);
+            const __m256i byte = _mm256_set1_epi32(0xFF);
+            const int* base = reinterpret_cast<const int*>(memory.data());
+            unsigned l = 0;
+            for(; l + 8 <= n; l += 8){
+                __m256i p = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&pc[l])));
+                __m256i lane = _mm256_add_epi32(_mm256_set1_epi32((int)l), laneStep);
+                __m256i a0 = _mm256_and_si256(p, mask12);
+                __m256i a1 = _mm256_and_si256(_mm256_add_epi32(p, _mm256_set1_epi32(1)), mask12);
+                __m256i hi = _mm256_i32gather_epi32(base, _mm256_add_epi32(_mm256_mullo_epi32(a0, stride8), lane), 1);
+                __m256i lo = _mm256_i32gather_epi32(base, _mm256_add_epi32(_mm256_mullo_epi32(a1, stride8), lane), 1);
+                __m256i op = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(hi, byte), 8), _mm256_and_si256(lo, byte));
+                __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(op), _mm256_extracti128_si256(op, 1));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(&opcode[l]), packed);
+            }
+            return l;
+        }
+#endif
+
+        /// One opcode over a set of lanes; mirrors Chip8::decode case by case
+        template<class Lanes>
+        CHIP8_INLINE void execute(unsigned op, const Lanes& L){
+            const unsigned x = (op & 0x0F00) >> 8;
+            const unsigned y = (op & 0x00F0) >> 4;
+            const unsigned d = op & 0x000F;
+            const unsigned kk = op & 0x00FF;
+            const uint16_t nnn = op & 0x0FFF;
+            const unsigned count = L.size();
+
+            uint16_t* PC = pc.data();
+            uint8_t* vx = &reg[x * (size_t)stride];
+            uint8_t* vy = &reg[y * (size_t)stride];
+            uint8_t* vf = &reg[15 * (size_t)stride];
+            uint8_t* v0 = reg.data();
+
+            switch(op & 0xF000){
+                case 0x0000:
+                    if(kk == 0xE0){                                     // CLS
+                        if constexpr(Lanes::ALL) memset(gfx.data(), 0, gfx.size());
+                        else for(unsigned i = 0; i < count; i++)
+                            memset(&gfx[L[i] * (size_t)2048], 0, 2048);
+                        for(unsigned i = 0; i < count; i++) PC[L[i]] += 2;
+                    }
+                    else if(kk == 0xEE){                                // RET
+                        for(unsigned i = 0; i < count; i++){
+                            unsigned l = L[i];
+                            sp[l]--;
+                            uint16_t& slotRef = stack[(sp[l] & 15) * (size_t)stride + l];
+                            PC[l] = slotRef;
+                            slotRef = 0;
+                        }
+                    }
+                    else for(unsigned i = 0; i < count; i++) PC[L[i]] += 2;
+                    break;
+
+                case 0x1000:                                            // JP addr
+                    for(unsigned i = 0; i < count; i++) PC[L[i]] = nnn;
+                    break;
+
+                case 0x2000:                                            // CALL addr
+                    for(unsigned i = 0; i < count; i++){
+                        unsigned l = L[i];
+                        stack[(sp[l] & 15) * (size_t)stride + l] = PC[l] + 2;
+                        sp[l]++;
+                        PC[l] = nnn;
+                    }
+                    break;
+
+                case 0x3000:                                            // SE Vx, byte
+                    for(unsigned i = 0; i < count; i++){ unsigned l = L[i]; PC[l] += vx[l] == kk ? 4 : 2; }
+                    break;
+
+                case 0x4000:                                            // SNE Vx, byte
+                    for(unsigned i = 0; i < count; i++){ unsigned l = L[i]; PC[l] += vx[l] != kk ? 4 : 2; }
+                    break;
+
+                case 0x5000:                                            // SE Vx, Vy
+                    for(unsigned i = 0; i < count; i++){ unsigned l = L[i]; PC[l] += vx[l] == vy[l] ? 4 : 2; }
+                    break;
+
+                case 0x6000:                                            // LD Vx, byte
+                    for(unsigned i = 0; i < count; i++){ unsigned l = L[i]; vx[l] = kk; PC[l] += 2; }
+                    break;
+
+                case 0x7000:                                            // ADD Vx, byte
+                    for(unsigned i = 0; i < count; i++){ unsigned l = L[i]; vx[l] += kk; PC[l] += 2; }
+                    break;
+
+                case 0x8000:
+                    // Same statement order as decode, so VF as x or y behaves identically
+                    switch(d){
+                        case 0x0: for(unsigned i = 0; i < count; i++){ unsigned l = L[i]; vx[l] = vy[l]; } break;
+                        case 0x1: for(unsigned i = 0; i < count; i++){ unsigned l = L[i]; vx[l] |= vy[l]; } break;
+                        case 0x2: for(unsigned i = 0; i < count; i++){ unsigned l = L[i]; vx[l] &= vy[l]; } break;
+                        case 0x3: for(unsigned i = 0; i < count; i++){ unsigned l = L[i]; vx[l] ^= vy[l]; } break;
+                        case 0x4:
+                            for(unsigned i = 0; i < count; i++){
+                                unsigned l = L[i];
+                                unsigned sum = vx[l] + vy[l];
+                                vf[l] = sum > 255;
+                                vx[l] = sum & 0xFF;
+                            }
+                            break;
+                        case 0x5:
+                            for(unsigned i = 0; i < count; i++){
+                                unsigned l = L[i];
+                                vf[l] = vx[l] > vy[l];
+                                vx[l] = vx[l] - vy[l];
+                            }
+                            break;
+                        case 0x6:
+                            for(unsigned i = 0; i < count; i++){
+                                unsigned l = L[i];
+                                vf[l] = vx[l] & 1;
+                                vx[l] >>= 1;
+                            }
+                            break;
+                        case 0x7:
+                            for(unsigned i = 0; i < count; i++){
+                                unsigned l = L[i];
+                                vf[l] = vy[l] > vx[l];
+                                vx[l] = vy[l] - vx[l];
+                            }
+                            break;
+                        case 0xE:
+                            for(unsigned i = 0; i < count; i++){
+                                unsigned l = L[i];
+                                vf[l] = (vx[l] & 0x80) >> 7;
+                                vx[l] <<= 1;
+                            }
+                            break;
+                    }
+                    for(unsigned i = 0; i < count; i++) PC[L[i]] += 2;
+                    break;
+
+                case 0x9000:                                            // SNE Vx, Vy
+                    for(unsigned i = 0; i < count; i++){ unsigned l = L[i]; PC[l] += (d == 0 && vx[l] != vy[l]) ? 4 : 2; }
+                    break;
+
+                case 0xA000:                                            // LD I, addr
+                    for(unsigned i = 0; i < count; i++){ unsigned l = L[i]; I[l] = nnn; PC[l] += 2; }
+                    break;
+
+                case 0xB000:                                            // JP V0, addr
+                    for(unsigned i = 0; i < count; i++){ unsigned l = L[i]; PC[l] = nnn + v0[l]; }
+                    break;
+
+                case 0xC000:                                            // RND Vx, byte
+                    for(unsigned i = 0; i < count; i++){
+                        unsigned l = L[i];
+                        vx[l] = (rng[l].next() & 0xFF) & kk;
+                        PC[l] += 2;
+                    }
+                    break;
+
+                case 0xD000:                                            // DRW Vx, Vy, nibble
+                    for(unsigned i = 0; i < count; i++){
+                        unsigned l = L[i];
+                        drawFlag[l] = 1;
+                        unsigned px = vx[l] % 64, py = vy[l] % 32;
+                        vf[l] = 0;
+                        for(unsigned yl = 0; yl < d; yl++){
+                            unsigned char bits = memory[(size_t)((I[l] + yl) & 0xFFF) * stride + l];
+                            for(unsigned xl = 0; xl < 8; xl++){
+                                if(bits & (0x80 >> xl)){
+                                    size_t index = ((py + yl) % 32) * 64 + (px + xl) % 64;
+                                    uint8_t& pixel = gfx[l * (size_t)2048 + index];
+                                    if(pixel == 1) vf[l] = 1;
+                                    pixel ^= 1;
+                                }
+                            }
+                        }
+                        PC[l] += 2;
+                    }
+                    break;
+
+                case 0xE000:
+                    if(kk == 0x9E)                                      // SKP Vx
+                        for(unsigned i = 0; i < count; i++){ unsigned l = L[i]; PC[l] += key[(vx[l] & 15) * (size_t)stride + l] ? 4 : 2; }
+                    else if(kk == 0xA1)                                 // SKNP Vx
+                        for(unsigned i = 0; i < count; i++){ unsigned l = L[i]; PC[l] += key[(vx[l] & 15) * (size_t)stride + l] ? 2 : 4; }
+                    break;
+
+                case 0xF000:
+                    switch(kk){
+                        case 0x07:                                      // LD Vx, DT
+                            for(unsigned i = 0; i < count; i++){ unsigned l = L[i]; vx[l] = delayTimer[l]; PC[l] += 2; }
+                            break;
+                        case 0x0A:                                      // LD Vx, K
+                            for(unsigned i = 0; i < count; i++){
+                                unsigned l = L[i];
+                                for(unsigned k = 0; k < 16; k++){
+                                    if(key[k * (size_t)stride + l]){
+                                        vx[l] = k;
+                                        PC[l] += 2;
+                                        break;
+                                    }
+                                }
+                            }
+                            break;
+                        case 0x15:                                      // LD DT, Vx
+                            for(unsigned i = 0; i < count; i++){ unsigned l = L[i]; delayTimer[l] = vx[l]; PC[l] += 2; }
+                            break;
+                        case 0x18:                                      // LD ST, Vx
+                            for(unsigned i = 0; i < count; i++){ unsigned l = L[i]; soundTimer[l] = vx[l]; PC[l] += 2; }
+                            break;
+                        case 0x1E:                                      // ADD I, Vx
+                            for(unsigned i = 0; i < count; i++){ unsigned l = L[i]; I[l] += vx[l]; PC[l] += 2; }
+                            break;
+                        case 0x29:                                      // LD F, Vx
+                            for(unsigned i = 0; i < count; i++){ unsigned l = L[i]; I[l] = 80 + vx[l] * 5; PC[l] += 2; }
+                            break;
+                        case 0x33:                                      // LD B, Vx
+                            for(unsigned i = 0; i < count; i++){
+                                unsigned l = L[i];
+                                unsigned char value = vx[l];
+                                memory[(size_t)(I[l] & 0xFFF) * stride + l] = value / 100;
+                                memory[(size_t)((I[l] + 1) & 0xFFF) * stride + l] = (value / 10) % 10;
+                                memory[(size_t)((I[l] + 2) & 0xFFF) * stride + l] = value % 10;
+                                PC[l] += 2;
+                            }
+                            break;
+                        case 0x55:                                      // LD [I], Vx
+                            for(unsigned i = 0; i < count; i++){
+                                unsigned l = L[i];
+                                for(unsigned r = 0; r <= x; r++)
+                                    memory[(size_t)((I[l] + r) & 0xFFF) * stride + l] = reg[r * (size_t)stride + l];
+                                PC[l] += 2;
+                            }
+                            break;
+                        case 0x65:                                      // LD Vx, [I]
+                            for(unsigned i = 0; i < count; i++){
+                                unsigned l = L[i];
+                                for(unsigned r = 0; r <= x; r++)
+                                    reg[r * (size_t)stride + l] = memory[(size_t)((I[l] + r) & 0xFFF) * stride + l];
+                                PC[l] += 2;
+                            }
+                            break;
+                    }
+                    break;
+            }
+        }
+};
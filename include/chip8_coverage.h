@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include "chip8.h"
+
+/// Guest code coverage for Chip8::runCycles(count, Hooks&): per address, how
+/// often an instruction was fetched there and how often the byte was read
+/// and written. A fetch costs one counter increment. Reads and writes are
+/// counted in the memory hooks, which only DXYN and Fx33/Fx55/Fx65 call.
+/// DXYN reads are kept apart from Fx65 loads, which tells sprites from other data.
+///
+/// The report covers the program area (0x200-0xFFF). Each byte falls into one
+/// class, in this order: code (part of an executed instruction), sprite (read
+/// by DXYN), data (loaded by Fx65 or stored by Fx33/Fx55), then unreached (in
+/// the ROM image but never touched) or free (past the image, never touched).
+class Chip8Coverage : public Chip8NoHooks {
+    public:
+        enum Class { CODE, SPRITE, DATA, UNREACHED, FREE, CLASSES };
+
+        uint32_t fetches[4096] = {};                // Instructions fetched at this address
+        uint32_t spriteReads[4096] = {};            // DXYN
+        uint32_t loads[4096] = {};                  // Fx65
+        uint32_t stores[4096] = {};                 // Fx33, Fx55
+
+        void onFetch(unsigned short pc, unsigned short op){
+            fetches[pc & 0xFFF]++;
+            lastOp = op;
+        }
+        void onMemoryRead(unsigned short, unsigned addr, unsigned count){
+            uint32_t* counts = (lastOp & 0xF000) == 0xD000 ? spriteReads : loads;
+            for(unsigned i = 0; i < count; i++) counts[(addr + i) & 0xFFF]++;
+        }
+        void onMemoryWrite(unsigned short, unsigned addr, unsigned count){
+            for(unsigned i = 0; i < count; i++) stores[(addr + i) & 0xFFF]++;
+        }
+
+        /// Either byte of an executed instruction
+        bool executed(unsigned addr) const {
+            return fetches[addr & 0xFFF] || fetches[(addr - 1) & 0xFFF];
+        }
+
+        /// Class of a program-area byte, for a ROM image of romSize bytes at 0x200
+        Class classify(unsigned addr, unsigned romSize) const {
+            addr &= 0xFFF;
+            if(executed(addr)) return CODE;
+            if(spriteReads[addr]) return SPRITE;
+            if(loads[addr] || stores[addr]) return DATA;
+            return addr < 0x200 + romSize ? UNREACHED : FREE;
+        }
+
+        static const char* className(int c){
+            static const char* names[CLASSES] = { "code", "sprite", "data", "unreached", "free" };
+            return names[c];
+        }
+
+        /// Bytes per class over the program area
+        void summarize(unsigned romSize, unsigned (&bytes)[CLASSES]) const {
+            for(int c = 0; c < CLASSES; c++) bytes[c] = 0;
+            for(unsigned a = 0x200; a < 4096; a++) bytes[classify(a, romSize)]++;
+        }
+
+        /// Summary and one line per run of same-class bytes (free space left out)
+        void writeText(FILE* out, unsigned romSize) const {
+            unsigned bytes[CLASSES];
+            summarize(romSize, bytes);
+            fprintf(out, "ROM 0x200-0x%03X (%u bytes): %u code, %u sprite, %u data, %u unreached (%.1f%% reached)\n",
+                    0x200 + romSize - 1, romSize, bytes[CODE], bytes[SPRITE], bytes[DATA], bytes[UNREACHED],
+                    reachedPercent(romSize));
+            forEachRange(romSize, [&](unsigned start, unsigned end, Class c, uint64_t hits){
+                fprintf(out, "  0x%03X-0x%03X  %-9s %5u bytes", start, end, className(c), end - start + 1);
+                if(hits) fprintf(out, "  %llu %s", (unsigned long long)hits,
+                                 c == CODE ? "fetches" : c == SPRITE ? "sprite reads" : "accesses");
+                fprintf(out, "\n");
+            });
+        }
+
+        /// The same as JSON
+        void writeJson(FILE* out, unsigned romSize) const {
+            unsigned bytes[CLASSES];
+            summarize(romSize, bytes);
+            fprintf(out, "{\n  \"rom_start\": \"0x200\",\n  \"rom_bytes\": %u,\n  \"bytes\": {", romSize);
+            for(int c = 0; c < CLASSES; c++)
+                fprintf(out, " \"%s\": %u%s", className(c), bytes[c], c + 1 < CLASSES ? "," : " ");
+            fprintf(out, "},\n  \"rom_reached_percent\": %.2f,\n  \"ranges\": [", reachedPercent(romSize));
+            bool first = true;
+            forEachRange(romSize, [&](unsigned start, unsigned end, Class c, uint64_t hits){
+                fprintf(out, "%s\n    { \"start\": \"0x%03X\", \"end\": \"0x%03X\", \"class\": \"%s\", \"hits\": %llu }",
+                        first ? "" : ",", start, end, className(c), (unsigned long long)hits);
+                first = false;
+            });
+            fprintf(out, "\n  ]\n}\n");
+        }
+
+        /// Binary PPM of all 4 KB, 64 bytes per row, each byte a scale x scale
+        /// cell. Green is fetches, blue reads, red writes, each on a log scale
+        /// against its busiest address. Untouched ROM bytes are dark grey.
+        bool writePpm(FILE* out, unsigned romSize, unsigned scale = 8) const {
+            uint32_t peak[3] = { 1, 1, 1 };
+            for(unsigned a = 0; a < 4096; a++){
+                uint32_t v[3];
+                channels(a, v);
+                for(int k = 0; k < 3; k++) if(v[k] > peak[k]) peak[k] = v[k];
+            }
+            unsigned side = 64 * scale;
+            fprintf(out, "P6\n%u %u\n255\n", side, side);
+            unsigned char row[64 * 3];
+            bool ok = true;
+            for(unsigned y = 0; y < 64 && ok; y++){
+                for(unsigned x = 0; x < 64; x++){
+                    unsigned a = y * 64 + x;
+                    uint32_t v[3];
+                    channels(a, v);
+                    bool touched = v[0] || v[1] || v[2];
+                    for(int k = 0; k < 3; k++)
+                        row[x * 3 + k] = touched ? heat(v[k], peak[k])
+                                       : a >= 0x200 && a < 0x200 + romSize ? 0x30 : 0;
+                }
+                for(unsigned sy = 0; sy < scale && ok; sy++)
+                    for(unsigned x = 0; x < 64 && ok; x++)
+                        for(unsigned sx = 0; sx < scale && ok; sx++)
+                            ok = fwrite(row + x * 3, 3, 1, out) == 1;
+            }
+            return ok;
+        }
+
+    private:
+        unsigned short lastOp = 0;
+
+        /// Heatmap red, green, blue: writes, fetches of either instruction byte, reads
+        void channels(unsigned a, uint32_t (&v)[3]) const {
+            v[0] = stores[a];
+            v[1] = fetches[a] + fetches[(a - 1) & 0xFFF];
+            v[2] = spriteReads[a] + loads[a];
+        }
+
+        /// 0 stays black; any access is at least 64 so rare ones still show
+        static unsigned char heat(uint32_t v, uint32_t peak){
+            if(!v) return 0;
+            return (unsigned char)(64 + 191 * std::log1p((double)v) / std::log1p((double)peak));
+        }
+
+        /// Share of the ROM image executed, read or written
+        double reachedPercent(unsigned romSize) const {
+            unsigned n = 0;
+            for(unsigned a = 0x200; a < 0x200 + romSize && a < 4096; a++) n += classify(a, romSize) < UNREACHED;
+            return 100.0 * n / (romSize ? romSize : 1);
+        }
+
+        /// Runs of same-class bytes over the program area, skipping free ones,
+        /// with the summed fetches (code) or reads and writes (others) of each
+        template<class F>
+        void forEachRange(unsigned romSize, F&& f) const {
+            unsigned start = 0x200;
+            Class run = classify(start, romSize);
+            uint64_t hits = 0;
+            for(unsigned a = 0x200; a <= 4096; a++){
+                Class c = a < 4096 ? classify(a, romSize) : FREE;
+                if(a == 4096 || c != run){
+                    if(run != FREE) f(start, a - 1, run, hits);
+                    start = a;
+                    run = c;
+                    hits = 0;
+                }
+                if(a < 4096) hits += c == CODE ? fetches[a] : c == SPRITE ? spriteReads[a] : loads[a] + stores[a];
+            }
+        }
+};
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "chip8.h"
+#include "chip8_watch.h"
+
+/// Time-travel debugging for one Chip8: step and continue in both directions.
+/// The timeline is the start state, the keypad changes by instruction index,
+/// and a snapshot parked every SNAPSHOT_INTERVAL instructions the first time
+/// execution passes there. Going back restores the nearest earlier snapshot
+/// and re-executes with the same keys, which the seeded core replays exactly.
+/// Breakpoints and watchpoints live in a Chip8Watch. Reverse searches re-run
+/// one interval at a time from the latest backwards under it, so they cost at
+/// most one re-execution per interval they cover.
+///
+/// Positions count instructions executed since the start: at position t the
+/// machine is about to fetch instruction t.
+class Chip8Debugger {
+    public:
+        static constexpr uint32_t SNAPSHOT_INTERVAL = 2048;    // ~20 us of re-execution at worst
+
+        /// A memory write found by reverseToWrite()
+        struct Write {
+            uint64_t instruction;                   // The writing instruction; the debugger stops just after it
+            uint16_t pc, opcode;
+            uint8_t before, after;
+        };
+
+        /// Debug from machine's current state, which becomes position 0
+        explicit Chip8Debugger(const Chip8& machine) : start(new Chip8State) {
+            machine.saveState(*start, false);
+            emu.loadState(*start, false);
+            emu.checkpoint(*start);
+            initialKeys = emu.getKeys();
+            snapshots.emplace_back();
+            emu.park(snapshots[0], *start);
+        }
+
+        const Chip8& machine() const { return emu; }
+        uint64_t position() const { return now; }
+        uint64_t furthest() const { return frontier; }     // Furthest position executed so far
+
+        /// Keypad mask from instruction `at` on (movie import). Discards any
+        /// recorded future from there, as a different input makes a different run.
+        void setKeys(uint64_t at, uint16_t mask){
+            keys.erase(std::lower_bound(keys.begin(), keys.end(), std::make_pair(at, (uint16_t)0)), keys.end());
+            keys.push_back({ at, mask });
+            size_t keep = (size_t)(at / SNAPSHOT_INTERVAL) + 1;     // The snapshot at `at` itself predates the change
+            if(snapshots.size() > keep) snapshots.resize(keep);
+            if(frontier > at) frontier = at;
+            if(now > at) restore(now);              // Re-execute the present with the new keys
+            else if(now == at) emu.setKeys(mask);
+        }
+
+        /// Keys held at the current position
+        uint16_t keysNow() const { return keysAt(now); }
+
+        /// Breakpoints and watchpoints continueForward() and reverseContinue() stop at
+        Chip8Watch& watch() { return watchpoints; }
+        const Chip8Watch& watch() const { return watchpoints; }
+
+        /// Why the last continue or reverse search stopped
+        const Chip8Watch::Hit& lastHit() const { return stopped; }
+
+        void step(uint64_t count = 1) { advance(count); }
+
+        /// Back count instructions (to the start at most); false if already there
+        bool reverseStep(uint64_t count = 1){
+            if(now == 0) return false;
+            seek(count < now ? now - count : 0);
+            return true;
+        }
+
+        /// Go to any position: forward from here, or from the nearest snapshot
+        /// at or before it when that is closer (always, going back)
+        void seek(uint64_t target){
+            if(target < now || target / SNAPSHOT_INTERVAL > now / SNAPSHOT_INTERVAL + 1) restore(target);
+            else advance(target - now);
+        }
+
+        /// Run until a breakpoint or watchpoint stops execution (leaving at least
+        /// one instruction behind) or `limit` instructions have run; true on a stop
+        bool continueForward(uint64_t limit){
+            return advance(limit, true);
+        }
+
+        /// Back to the latest earlier position where running forward would have
+        /// stopped: before a breakpoint, or just after a watched access
+        bool reverseContinue(){
+            uint64_t here = now;
+            uint64_t at = watchpoints.empty() ? NONE : lastStopBefore(watchpoints, here);
+            seek(at == NONE ? here : at);
+            return at != NONE;
+        }
+
+        /// Back to just after the latest instruction before the current one that
+        /// stored to addr (Fx33, Fx55; DXYN writes only the display), with its old and new value
+        bool reverseToWrite(unsigned addr, Write& w){
+            Chip8Watch writes;
+            writes.watchMemory(addr, Chip8Watch::WRITE);
+            uint64_t here = now;
+            uint64_t at = lastStopBefore(writes, here);
+            if(at == NONE){
+                seek(here);
+                return false;
+            }
+            seek(at - 1);
+            w.instruction = at - 1;
+            w.pc = emu.getPC();
+            w.opcode = (uint16_t)(emu.readMemory(w.pc) << 8 | emu.readMemory(w.pc + 1));
+            w.before = emu.readMemory(addr);
+            advance(1);
+            w.after = emu.readMemory(addr);
+            return true;
+        }
+
+        size_t snapshotCount() const { return snapshots.size(); }
+
+        /// Bytes the timeline holds: parked snapshots, the start state and key changes
+        size_t timelineBytes() const {
+            size_t bytes = sizeof(Chip8State) + keys.capacity() * sizeof(keys[0]);
+            for(const auto& s : snapshots) bytes += s.residentBytes();
+            return bytes;
+        }
+
+    private:
+        static constexpr uint64_t NONE = ~0ull;
+
+        Chip8 emu{ false };
+        std::unique_ptr<Chip8State> start;          // Position 0, and the base snapshots are parked against
+        std::vector<Chip8Parked> snapshots;         // snapshots[k] is position k * SNAPSHOT_INTERVAL
+        std::vector<std::pair<uint64_t, uint16_t>> keys;   // (position, mask) changes, sorted
+        Chip8Watch watchpoints;
+        Chip8Watch::Hit stopped;
+        uint64_t now = 0, frontier = 0;
+        uint16_t initialKeys = 0;
+
+        uint16_t keysAt(uint64_t t) const {
+            auto it = std::upper_bound(keys.begin(), keys.end(), std::make_pair(t, (uint16_t)0xFFFF));
+            return it == keys.begin() ? initialKeys : (it - 1)->second;
+        }
+
+        /// Restore the nearest snapshot at or before target and re-execute from it
+        void restore(uint64_t target){
+            size_t k = (size_t)std::min<uint64_t>(target / SNAPSHOT_INTERVAL, snapshots.size() - 1);
+            emu.unpark(snapshots[k]);
+            now = k * (uint64_t)SNAPSHOT_INTERVAL;
+            emu.setKeys(keysAt(now));
+            advance(target - now);
+        }
+
+        /// Run count instructions forward, applying key changes at their
+        /// positions and parking a snapshot at each interval boundary reached
+        /// first. Watched, it ends early where the watchpoints stop it (true).
+        bool advance(uint64_t count, bool watched = false){
+            uint64_t target = now + count;
+            bool hit = false;
+            auto event = std::upper_bound(keys.begin(), keys.end(), std::make_pair(now, (uint16_t)0xFFFF));
+            while(now < target){
+                uint64_t stop = target;
+                uint64_t boundary = (now / SNAPSHOT_INTERVAL + 1) * SNAPSHOT_INTERVAL;
+                if(boundary < stop) stop = boundary;
+                if(event != keys.end() && event->first < stop) stop = event->first;
+                if(watched) now += watchpoints.run(emu, (unsigned long)(stop - now));
+                else{
+                    emu.runCycles((unsigned long)(stop - now));
+                    now = stop;
+                }
+                while(event != keys.end() && event->first == now) emu.setKeys((event++)->second);
+                if(now % SNAPSHOT_INTERVAL == 0 && now / SNAPSHOT_INTERVAL == snapshots.size()){
+                    snapshots.emplace_back();
+                    emu.park(snapshots.back(), *start);
+                }
+                if(watched && watchpoints.hit().reason != Chip8Watch::NONE){
+                    stopped = watchpoints.hit();
+                    hit = true;
+                    break;
+                }
+            }
+            if(now > frontier) frontier = now;
+            return hit;
+        }
+
+        /// Latest position before limit where running forward under w stops
+        /// (NONE if there is none), re-running intervals from the latest backwards.
+        /// Leaves the machine anywhere; sets `stopped` on success.
+        uint64_t lastStopBefore(Chip8Watch& w, uint64_t limit){
+            if(limit == 0) return NONE;
+            for(size_t k = (size_t)std::min<uint64_t>((limit - 1) / SNAPSHOT_INTERVAL, snapshots.size() - 1) + 1; k-- > 0; ){
+                uint64_t from = k * (uint64_t)SNAPSHOT_INTERVAL;
+                uint64_t to = std::min<uint64_t>(from + SNAPSHOT_INTERVAL, limit - 1);     // Stops in (from, to]
+                emu.unpark(snapshots[k]);
+                emu.setKeys(keysAt(from));
+                now = from;
+                uint64_t found = NONE;
+                Chip8Watch::Hit hit;
+                if(from == 0 && w.isBreakpoint(emu.getPC())){   // Position 0 has no instruction before it
+                    found = 0;
+                    hit.reason = Chip8Watch::BREAKPOINT;
+                    hit.pc = hit.where = emu.getPC();
+                    hit.opcode = (uint16_t)(emu.readMemory(hit.pc) << 8 | emu.readMemory(hit.pc + 1));
+                }
+                auto event = std::upper_bound(keys.begin(), keys.end(), std::make_pair(from, (uint16_t)0xFFFF));
+                while(now < to){
+                    uint64_t stop = event != keys.end() && event->first < to ? event->first : to;
+                    now += w.run(emu, (unsigned long)(stop - now));
+                    while(event != keys.end() && event->first == now) emu.setKeys((event++)->second);
+                    if(w.hit().reason != Chip8Watch::NONE){
+                        found = now;
+                        hit = w.hit();
+                    }
+                }
+                if(found != NONE){
+                    stopped = hit;
+                    return found;
+                }
+            }
+            return NONE;
+        }
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include "chip8.h"
+#include "chip8_batch.h"
+
+/// Core adapters for Chip8Differ. A core can load and save a Chip8State,
+/// take the keypad and run instructions; nothing else is assumed.
+struct Chip8ReferenceCore {
+    Chip8 emu{ false };
+    void load(const Chip8State& s) { emu.loadState(s, false); }
+    void save(Chip8State& s) const { emu.saveState(s, false); }
+    void setKeys(unsigned short mask) { emu.setKeys(mask); }
+    void run(unsigned long cycles) { emu.runCycles(cycles); }
+};
+
+/// Lane 0 of a one-lane Chip8Batch
+struct Chip8BatchCore {
+    Chip8Batch batch{ 1 };
+    void load(const Chip8State& s) { batch.loadState(0, s, false); }
+    void save(Chip8State& s) const { batch.saveState(0, s); }
+    void setKeys(unsigned short mask) { batch.setKeys(0, mask); }
+    void run(unsigned long cycles) { batch.runCycles(cycles); }
+};
+
+/// Print the architectural fields where a and b differ (everything
+/// Chip8::matchesState compares); returns the number of differing fields
+inline unsigned chip8PrintStateDiff(FILE* out, const Chip8State& a, const Chip8State& b){
+    unsigned diffs = 0;
+    auto field = [&](const char* name, unsigned x, unsigned y){
+        if(x == y) return;
+        fprintf(out, "  %-6s 0x%04X  0x%04X\n", name, x, y);
+        diffs++;
+    };
+    char name[16];
+    field("pc", a.pc, b.pc);
+    field("I", a.I, b.I);
+    field("sp", a.sp, b.sp);
+    field("DT", a.delayTimer, b.delayTimer);
+    field("ST", a.soundTimer, b.soundTimer);
+    for(int i = 0; i < 16; i++){ snprintf(name, sizeof(name), "V%X", i); field(name, a.reg[i], b.reg[i]); }
+    for(int i = 0; i < 16; i++){ snprintf(name, sizeof(name), "S%d", i); field(name, a.stack[i], b.stack[i]); }
+    for(int i = 0; i < 16; i++){ snprintf(name, sizeof(name), "K%X", i); field(name, a.key[i], b.key[i]); }
+    if(memcmp(a.rng, b.rng, sizeof(a.rng))){
+        fprintf(out, "  rng state differs\n");
+        diffs++;
+    }
+    unsigned shown = 0, bytes = 0;
+    for(unsigned addr = 0; addr < 4096; addr++){
+        if(a.memory[addr] == b.memory[addr]) continue;
+        if(shown++ < 8) fprintf(out, "  [%03X]  0x%02X    0x%02X\n", addr, a.memory[addr], b.memory[addr]);
+        bytes++;
+    }
+    if(bytes > 8) fprintf(out, "  ... %u memory bytes differ\n", bytes);
+    diffs += bytes;
+    unsigned pixels = 0;
+    for(unsigned p = 0; p < 2048; p++) pixels += a.gfx[p] != b.gfx[p];
+    if(pixels) fprintf(out, "  %u pixels differ\n", pixels);
+    return diffs + pixels;
+}
+
+/// Whether a and b would run the same from here on (Chip8::matchesState's fields)
+inline bool chip8SameArchState(const Chip8State& a, const Chip8State& b){
+    return a.pc == b.pc && a.I == b.I && a.sp == b.sp && a.delayTimer == b.delayTimer && a.soundTimer == b.soundTimer
+        && !memcmp(a.reg, b.reg, sizeof(a.reg)) && !memcmp(a.stack, b.stack, sizeof(a.stack))
+        && !memcmp(a.key, b.key, sizeof(a.key)) && !memcmp(a.rng, b.rng, sizeof(a.rng))
+        && !memcmp(a.gfx, b.gfx, sizeof(a.gfx)) && !memcmp(a.memory, b.memory, sizeof(a.memory));
+}
+
+/// Runs two cores in lockstep, frame by frame with the same keys, and compares
+/// their full state every `interval` frames. On a mismatch both cores restart
+/// from the last matching snapshot and step through that window one
+/// instruction at a time, comparing after each, to find the first one after
+/// which they disagree. A divergence that heals before the next compare goes
+/// unseen; interval 1 catches every one.
+/// Keys(frame) returns the keypad mask held during that frame.
+template<class CoreA, class CoreB>
+class Chip8Differ {
+    public:
+        struct Divergence {
+            bool found = false;
+            unsigned long long instruction = 0;     // 0-based index of the first divergent instruction
+            unsigned long frame = 0;
+            unsigned short pc = 0;                  // Where it was fetched (from core A's state before it)
+            unsigned short opcode = 0;
+            Chip8State before;                      // Both cores agree here
+            Chip8State afterA, afterB;              // One instruction later
+        };
+
+        CoreA a;
+        CoreB b;
+
+        /// Run `frames` frames from start; returns at the first divergence
+        template<class Keys>
+        Divergence run(const Chip8State& start, unsigned long frames, unsigned long interval, Keys keys){
+            Divergence d;
+            if(interval == 0) interval = 1;
+            a.load(start);
+            b.load(start);
+            memcpy(&good, &start, sizeof(good));
+            unsigned long goodFrame = 0;
+            for(unsigned long f = 0; f < frames; ){
+                unsigned long n = frames - f < interval ? frames - f : interval;
+                for(unsigned long k = 0; k < n; k++){
+                    unsigned short mask = keys(f + k);
+                    a.setKeys(mask);
+                    b.setKeys(mask);
+                    a.run(Chip8::CYCLES_PER_FRAME);
+                    b.run(Chip8::CYCLES_PER_FRAME);
+                }
+                f += n;
+                compared += n * Chip8::CYCLES_PER_FRAME;
+                a.save(sa);
+                b.save(sb);
+                if(!chip8SameArchState(sa, sb)){
+                    scan(goodFrame, n * Chip8::CYCLES_PER_FRAME, keys, d);
+                    return d;
+                }
+                memcpy(&good, &sa, sizeof(good));
+                goodFrame = f;
+            }
+            return d;
+        }
+
+        unsigned long long instructionsCompared() const { return compared; }
+
+    private:
+        Chip8State good, sa, sb;                    // Last matching state, scratch
+        unsigned long long compared = 0;
+
+        /// Restore both cores to `good` (at goodFrame) and single-step them
+        /// through the window, comparing after every instruction. Cores can
+        /// differ and agree again (a wrong carry overwritten before the next
+        /// compare), so a bisection over the window could land on a later
+        /// divergence; the window is at most interval frames, so stepping is cheap.
+        template<class Keys>
+        void scan(unsigned long goodFrame, unsigned long window, Keys& keys, Divergence& d){
+            const unsigned cpf = Chip8::CYCLES_PER_FRAME;
+            a.load(good);
+            b.load(good);
+            memcpy(&d.before, &good, sizeof(d.before));
+            for(unsigned long i = 0; i < window; i++){
+                if(i % cpf == 0){
+                    unsigned short mask = keys(goodFrame + i / cpf);
+                    a.setKeys(mask);
+                    b.setKeys(mask);
+                }
+                a.run(1);
+                b.run(1);
+                a.save(d.afterA);
+                b.save(d.afterB);
+                if(!chip8SameArchState(d.afterA, d.afterB)){
+                    d.found = true;
+                    d.instruction = (unsigned long long)goodFrame * cpf + i;
+                    d.frame = goodFrame + i / cpf;
+                    d.pc = d.before.pc;
+                    d.opcode = (unsigned short)(d.before.memory[d.pc & 0xFFF] << 8 | d.before.memory[(d.pc + 1) & 0xFFF]);
+                    return;
+                }
+                memcpy(&d.before, &d.afterA, sizeof(d.before));
+            }
+        }
+};
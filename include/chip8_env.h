@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "chip8.h"
+#include "chip8_batch.h"
+#include "chip8_pool.h"
+
+/// Reward/termination rule on one memory byte, checked after every step
+struct Chip8EnvRule {
+    enum Kind {
+        DELTA,                      // Fires when the byte changes; reward * (new - old)
+        MATCH                       // Fires while the byte equals value; reward
+    };
+
+    uint16_t address = 0;
+    Kind kind = DELTA;
+    uint8_t value = 0;
+    float reward = 1;
+    bool terminal = false;          // Firing ends the episode
+};
+
+/// Vectorized environment: N copies of one ROM stepped together for
+/// reinforcement learning. An action is a keypad mask (bit i = key i) held
+/// for frameskip frames. Environments are split into shards of lanesPerShard
+/// lanes and the shards of one step run in parallel on a Chip8Pool. A shard
+/// is one Chip8Batch (LOCKSTEP) or lanesPerShard Chip8 instances (SCALAR).
+/// Lockstep wins while environments run the same code; when per-env input
+/// sends them down different paths every frame (Pong) SCALAR is faster, see
+/// the "env" section of chip8_bench.
+///
+/// Observations go straight into the caller's buffer, envs() * obsBytes()
+/// bytes, environment i at offset i * obsBytes():
+///   OBS_8BPP - 2048 bytes, one byte per pixel (0 or 1) as Chip8::getGfx
+///   OBS_1BPP - 256 bytes, 8 pixels per byte, leftmost pixel in the top bit
+/// step() allocates nothing. An environment whose episode ends (terminal
+/// rule or maxFrames) is reset within the same step: done[i] is 1 and the
+/// observation is the first one of the new episode.
+class Chip8VecEnv {
+    public:
+        enum ObsFormat { OBS_8BPP, OBS_1BPP };
+        enum Engine { LOCKSTEP, SCALAR };
+
+        struct Config {
+            unsigned frameskip = 4;
+            ObsFormat obs = OBS_8BPP;
+            Engine engine = SCALAR;                 // Per-env input diverges; see above
+            unsigned long maxFrames = 0;            // Episode length limit, 0 = none
+            uint64_t seed = 1;                      // Episode k of env i uses seed + i + k * envs
+            Chip8Rng::Algorithm rng = Chip8Rng::PCG32;
+            unsigned lanesPerShard = 64;
+            unsigned threads = 0;                   // 0 = all hardware threads
+            std::vector<Chip8EnvRule> rules;
+        };
+
+        Chip8VecEnv(const unsigned char* program, int size, unsigned envs, const Config& config)
+            : cfg(config), n(envs), pool(config.threads),
+              frames(envs), episodes(envs), previous(envs * config.rules.size()) {
+            if(cfg.lanesPerShard == 0) cfg.lanesPerShard = 1;
+            if(cfg.frameskip == 0) cfg.frameskip = 1;
+            Chip8 proto(false);
+            proto.init(cfg.seed, cfg.rng);
+            proto.loadProgram(program, size);
+            proto.saveState(start, false);
+
+            for(unsigned first = 0; first < n; first += cfg.lanesPerShard){
+                unsigned lanes = n - first < cfg.lanesPerShard ? n - first : cfg.lanesPerShard;
+                shards.emplace_back(new Shard(first, lanes, cfg.engine));
+            }
+        }
+
+        unsigned envs() const { return n; }
+        size_t obsBytes() const { return cfg.obs == OBS_1BPP ? 256 : 2048; }
+        unsigned long long steps() const { return stepCount; }        // Summed over environments
+
+        /// Start a new episode in every environment; call before the first step()
+        void reset(uint8_t* obs){
+            pool.run(shards.size(), [&](size_t s, unsigned){
+                Shard& sh = *shards[s];
+                for(unsigned l = 0; l < sh.lanes; l++) restart(sh, l, obs);
+            });
+        }
+
+        /// Start a new episode in environments ids[0..count); only their observations are written
+        void reset(const unsigned* ids, size_t count, uint8_t* obs){
+            for(size_t k = 0; k < count; k++){
+                if(ids[k] >= n) continue;
+                Shard& sh = *shards[ids[k] / cfg.lanesPerShard];
+                restart(sh, ids[k] - sh.first, obs);
+            }
+        }
+
+        /// Hold actions[i] on environment i for frameskip frames
+        void step(const uint16_t* actions, uint8_t* obs, float* rewards, uint8_t* done){
+            pool.run(shards.size(), [&](size_t s, unsigned){
+                Shard& sh = *shards[s];
+                const unsigned long cycles = (unsigned long)cfg.frameskip * Chip8::CYCLES_PER_FRAME;
+                if(sh.batch){
+                    for(unsigned l = 0; l < sh.lanes; l++) sh.batch->setKeys(l, actions[sh.first + l]);
+                    sh.batch->runCycles(cycles);
+                }
+                else{
+                    for(unsigned l = 0; l < sh.lanes; l++){
+                        sh.emus[l].setKeys(actions[sh.first + l]);
+                        sh.emus[l].runCycles(cycles);
+                    }
+                }
+                for(unsigned l = 0; l < sh.lanes; l++){
+                    unsigned e = sh.first + l;
+                    bool over = false;
+                    rewards[e] = score(sh, l, over);
+                    frames[e] += cfg.frameskip;
+                    if(cfg.maxFrames && frames[e] >= cfg.maxFrames) over = true;
+                    done[e] = over;
+                    if(over) restart(sh, l, obs);
+                    else observe(sh, l, obs);
+                }
+            });
+            stepCount += n;
+        }
+
+    private:
+        struct Shard {
+            Shard(unsigned firstEnv, unsigned laneCount, Engine engine) : first(firstEnv), lanes(laneCount) {
+                if(engine == LOCKSTEP) batch.reset(new Chip8Batch(laneCount));
+                else emus.assign(laneCount, Chip8(false));
+            }
+            unsigned first, lanes;
+            std::unique_ptr<Chip8Batch> batch;      // LOCKSTEP
+            std::vector<Chip8> emus;                // SCALAR
+            Chip8State scratch;                     // Reset image with this episode's seed
+
+            unsigned char read(unsigned lane, unsigned addr) const {
+                return batch ? batch->readMemory(lane, addr) : emus[lane].readMemory(addr);
+            }
+            const unsigned char* gfx(unsigned lane) const {
+                return batch ? batch->getGfx(lane) : emus[lane].getGfx();
+            }
+        };
+
+        Config cfg;
+        unsigned n;
+        Chip8Pool pool;
+        Chip8State start;                           // Machine right after loading the ROM
+        std::vector<std::unique_ptr<Shard>> shards;
+        std::vector<unsigned long> frames;          // Per env: frames into the episode
+        std::vector<unsigned long long> episodes;   // Per env: episodes started
+        std::vector<uint8_t> previous;              // Per env and rule: byte after the last step
+        unsigned long long stepCount = 0;
+
+        void restart(Shard& sh, unsigned lane, uint8_t* obs){
+            unsigned e = sh.first + lane;
+            Chip8Rng rng;
+            rng.seed(cfg.seed + e + episodes[e]++ * n, cfg.rng);
+            memcpy(&sh.scratch, &start, sizeof(start));
+            memcpy(sh.scratch.rng, &rng, sizeof(rng));
+            if(sh.batch) sh.batch->loadState(lane, sh.scratch, false);
+            else sh.emus[lane].loadState(sh.scratch, false);
+            frames[e] = 0;
+            for(size_t r = 0; r < cfg.rules.size(); r++)
+                previous[e * cfg.rules.size() + r] = sh.read(lane, cfg.rules[r].address);
+            observe(sh, lane, obs);
+        }
+
+        float score(Shard& sh, unsigned lane, bool& over){
+            float total = 0;
+            uint8_t* prev = &previous[(size_t)(sh.first + lane) * cfg.rules.size()];
+            for(size_t r = 0; r < cfg.rules.size(); r++){
+                const Chip8EnvRule& rule = cfg.rules[r];
+                uint8_t now = sh.read(lane, rule.address);
+                bool fired = rule.kind == Chip8EnvRule::DELTA ? now != prev[r] : now == rule.value;
+                if(fired){
+                    total += rule.kind == Chip8EnvRule::DELTA ? rule.reward * ((int)now - (int)prev[r]) : rule.reward;
+                    over |= rule.terminal;
+                }
+                prev[r] = now;
+            }
+            return total;
+        }
+
+        void observe(const Shard& sh, unsigned lane, uint8_t* obs) const {
+            if(!obs) return;
+            uint8_t* out = obs + (size_t)(sh.first + lane) * obsBytes();
+            const unsigned char* px = sh.gfx(lane);
+            if(cfg.obs == OBS_8BPP){
+                memcpy(out, px, 2048);
+                return;
+            }
+            // Eight 0/1 bytes to one (little-endian load): the multiply moves byte i's
+            // bit to bit 63 - i, and no two partial products overlap
+            for(unsigned b = 0; b < 256; b++, px += 8){
+                uint64_t bytes;
+                memcpy(&bytes, px, 8);
+                out[b] = (uint8_t)((bytes * 0x8040201008040201ull) >> 56);
+            }
+        }
+};
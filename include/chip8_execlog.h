@@ -0,0 +1,831 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "chip8.h"
+
+// Execution log: one record per executed instruction, written by the
+// Chip8ExecLogger hooks through a Chip8ExecLogWriter and read back with
+// Chip8ExecLogReader. File layout, little-endian:
+//
+//     header   "C8XL", version u16, reserved u16, checkpoint interval u32
+//     records  back to back, see below
+//     index    per checkpoint: instruction u64, stateHash u64, file offset u64
+//     footer   index offset u64, checkpoint count u64, "C8XI"
+//
+// A record is a flags byte followed by the fields it selects, in this order:
+//     PC     zigzag varint of pc - (previous pc + 2)      absent: sequential
+//     OP     opcode, big-endian                           absent: same as the last fetch from pc
+//     REG    one V register changed: its number, then its new value
+//     REGS   several changed: 16-bit mask of them, then their new values
+//     INDEX  zigzag varint of the change to I (16-bit wrap)
+//     SP     new sp
+// followed, for Fx33 and Fx55, by the 3 or x+1 bytes written at the old I.
+// Changes are those the instruction made; timers count down every instruction
+// and keys come from outside, so neither is logged.
+// A flags byte of 0x80 is a checkpoint instead: varint instruction count,
+// stateHash() (8 bytes), then pc and I (2 bytes each), sp and V0-VF. Decoding
+// context restarts there, so reading can begin at any checkpoint. A closing
+// checkpoint is always written, so the last index entry holds the run length.
+
+/// Append v as a LEB128 varint
+inline uint8_t* chip8PutVarint(uint8_t* p, uint64_t v){
+    while(v >= 0x80){
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+inline bool chip8GetVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v){
+    v = 0;
+    for(unsigned shift = 0; p < end && shift < 64; shift += 7){
+        uint8_t b = *p++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if(!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+inline uint32_t chip8Zigzag(int32_t d) { return (uint32_t)d << 1 ^ (uint32_t)(d >> 31); }
+inline int32_t chip8Unzigzag(uint64_t z) { return (int32_t)(z >> 1) ^ -(int32_t)(z & 1); }
+
+/// Bit i set for every nonzero byte i of x
+CHIP8_INLINE unsigned chip8NonzeroBytes(uint64_t x){
+    uint64_t y = ((x & 0x7F7F7F7F7F7F7F7Full) + 0x7F7F7F7F7F7F7F7Full) | x;     // Byte's top bit: nonzero
+    y = (y >> 7) & 0x0101010101010101ull;
+    return (unsigned)((y * 0x0102040810204080ull) >> 56);
+}
+
+/// Conventional mnemonic for an opcode ("LD V3, 0x2A"), as the decoder prints it
+inline void chip8Disassemble(unsigned op, char* out, size_t size){
+    unsigned x = (op >> 8) & 15, y = (op >> 4) & 15, n = op & 15, kk = op & 0xFF, nnn = op & 0xFFF;
+    static const char* const ALU[16] = { "LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN",
+                                         nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, "SHL", nullptr };
+    switch(op >> 12){
+        case 0x0:
+            if(kk == 0xE0) snprintf(out, size, "CLS");         // The core ignores the x nibble here
+            else if(kk == 0xEE) snprintf(out, size, "RET");
+            else snprintf(out, size, "SYS 0x%03X", nnn);
+            return;
+        case 0x1: snprintf(out, size, "JP 0x%03X", nnn); return;
+        case 0x2: snprintf(out, size, "CALL 0x%03X", nnn); return;
+        case 0x3: snprintf(out, size, "SE V%X, 0x%02X", x, kk); return;
+        case 0x4: snprintf(out, size, "SNE V%X, 0x%02X", x, kk); return;
+        case 0x5: if(n == 0){ snprintf(out, size, "SE V%X, V%X", x, y); return; } break;
+        case 0x6: snprintf(out, size, "LD V%X, 0x%02X", x, kk); return;
+        case 0x7: snprintf(out, size, "ADD V%X, 0x%02X", x, kk); return;
+        case 0x8: if(ALU[n]){ snprintf(out, size, "%s V%X, V%X", ALU[n], x, y); return; } break;
+        case 0x9: if(n == 0){ snprintf(out, size, "SNE V%X, V%X", x, y); return; } break;
+        case 0xA: snprintf(out, size, "LD I, 0x%03X", nnn); return;
+        case 0xB: snprintf(out, size, "JP V0, 0x%03X", nnn); return;
+        case 0xC: snprintf(out, size, "RND V%X, 0x%02X", x, kk); return;
+        case 0xD: snprintf(out, size, "DRW V%X, V%X, %u", x, y, n); return;
+        case 0xE:
+            if(kk == 0x9E){ snprintf(out, size, "SKP V%X", x); return; }
+            if(kk == 0xA1){ snprintf(out, size, "SKNP V%X", x); return; }
+            break;
+        case 0xF:
+            switch(kk){
+                case 0x07: snprintf(out, size, "LD V%X, DT", x); return;
+                case 0x0A: snprintf(out, size, "LD V%X, K", x); return;
+                case 0x15: snprintf(out, size, "LD DT, V%X", x); return;
+                case 0x18: snprintf(out, size, "LD ST, V%X", x); return;
+                case 0x1E: snprintf(out, size, "ADD I, V%X", x); return;
+                case 0x29: snprintf(out, size, "LD F, V%X", x); return;
+                case 0x33: snprintf(out, size, "LD B, V%X", x); return;
+                case 0x55: snprintf(out, size, "LD [I], V%X", x); return;
+                case 0x65: snprintf(out, size, "LD V%X, [I]", x); return;
+            }
+            break;
+    }
+    snprintf(out, size, "DW 0x%04X", op);
+}
+
+/// Memory bytes an opcode writes at I (Fx33, Fx55); 0 for everything else
+inline unsigned chip8MemoryWriteCount(unsigned op){
+    if((op & 0xF0FF) == 0xF033) return 3;
+    if((op & 0xF0FF) == 0xF055) return ((op >> 8) & 15) + 1;
+    return 0;
+}
+
+/// What an opcode can change besides pc, as CHIP8_LOG_* bits: Vx, VF, I, or
+/// OTHER for anything more (sp, memory, several registers). Unknown opcodes
+/// change nothing. Chip8ExecLogger inlines the records of all but OTHER.
+enum : unsigned { CHIP8_LOG_VX = 1, CHIP8_LOG_VF = 2, CHIP8_LOG_I = 4, CHIP8_LOG_OTHER = 8 };
+
+inline unsigned chip8LogEffects(unsigned op){
+    switch(op >> 12){
+        case 0x0: return (op & 0xFF) == 0xEE ? (unsigned)CHIP8_LOG_OTHER : 0u;
+        case 0x2: return CHIP8_LOG_OTHER;
+        case 0x6: case 0x7: case 0xC: return CHIP8_LOG_VX;
+        case 0x8:
+            if((op & 15) <= 3) return CHIP8_LOG_VX;
+            if((op & 15) <= 7 || (op & 15) == 0xE) return CHIP8_LOG_VX | CHIP8_LOG_VF;
+            return 0;
+        case 0xA: return CHIP8_LOG_I;
+        case 0xD: return CHIP8_LOG_VF;
+        case 0xF:
+            switch(op & 0xFF){
+                case 0x07: case 0x0A: return CHIP8_LOG_VX;
+                case 0x1E: case 0x29: return CHIP8_LOG_I;
+                case 0x33: case 0x55: case 0x65: return CHIP8_LOG_OTHER;
+            }
+            return 0;
+        default: return 0;                          // Jumps and skips
+    }
+}
+
+namespace Chip8ExecLog {
+    static constexpr uint16_t VERSION = 1;
+    static constexpr size_t HEADER_BYTES = 12;
+    static constexpr size_t FOOTER_BYTES = 20;
+    static constexpr size_t INDEX_ENTRY_BYTES = 24;
+
+    enum : uint8_t { PC = 1, OP = 2, REG = 4, REGS = 8, INDEX = 16, SP = 32, CHECKPOINT = 0x80 };
+
+    inline void put16(uint8_t* p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+    inline void put32(uint8_t* p, uint32_t v) { for(int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> 8 * i); }
+    inline void put64(uint8_t* p, uint64_t v) { for(int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> 8 * i); }
+    inline uint16_t get16(const uint8_t* p) { return (uint16_t)(p[0] | p[1] << 8); }
+    inline uint32_t get32(const uint8_t* p) { uint32_t v = 0; for(int i = 3; i >= 0; i--) v = v << 8 | p[i]; return v; }
+    inline uint64_t get64(const uint8_t* p) { uint64_t v = 0; for(int i = 7; i >= 0; i--) v = v << 8 | p[i]; return v; }
+}
+
+/// Streams log records to a file. Records are appended to one of two fixed
+/// buffers; a full buffer goes to a background thread that writes it while the
+/// other fills. Capture waits only if the disk falls a whole buffer behind,
+/// so memory stays at 2 * BUFFER_BYTES however long the run.
+class Chip8ExecLogWriter {
+    public:
+        static constexpr size_t BUFFER_BYTES = 1 << 20;
+        static constexpr size_t MAX_RECORD = 64;    // Largest record (checkpoint or instruction) plus slack
+
+        struct Checkpoint { uint64_t instruction, hash, offset; };
+
+        Chip8ExecLogWriter() = default;
+        ~Chip8ExecLogWriter(){ close(); }
+
+        Chip8ExecLogWriter(const Chip8ExecLogWriter&) = delete;
+        Chip8ExecLogWriter& operator=(const Chip8ExecLogWriter&) = delete;
+
+        /// Create path and start the flush thread. A checkpoint every
+        /// checkpointInterval instructions bounds how far a reader has to decode.
+        bool open(const char* path, uint32_t checkpointInterval = 1u << 16){
+            close();
+#ifdef _WIN32
+            fd = _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+            fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+            if(fd < 0) return false;
+            interval = checkpointInterval ? checkpointInterval : 1;
+            for(auto& b : buffers) b.resize(BUFFER_BYTES);
+            active = buffers[0].data();
+            memcpy(active, "C8XL", 4);
+            Chip8ExecLog::put16(active + 4, Chip8ExecLog::VERSION);
+            Chip8ExecLog::put16(active + 6, 0);
+            Chip8ExecLog::put32(active + 8, interval);
+            used = Chip8ExecLog::HEADER_BYTES;
+            flushed = 0;
+            pendingBytes = 0;
+            stop = failed = false;
+            index.clear();
+            flusher = std::thread([this]{ flushLoop(); });
+            return true;
+        }
+
+        /// Room for one record at the end of the buffer; finish it with commit()
+        CHIP8_INLINE uint8_t* reserve(){
+            if(BUFFER_BYTES - used < MAX_RECORD) handOff();
+            return active + used;
+        }
+
+        CHIP8_INLINE void commit(const uint8_t* end) { used = (size_t)(end - active); }
+
+        /// File offset of the next record
+        uint64_t offset() const { return flushed + used; }
+
+        void addCheckpoint(uint64_t instruction, uint64_t hash, uint64_t at){
+            index.push_back(Checkpoint{ instruction, hash, at });
+        }
+
+        uint32_t checkpointInterval() const { return interval; }
+        bool isOpen() const { return fd >= 0; }
+
+        /// Flush, append the checkpoint index and close; false if any write failed
+        bool close(){
+            if(fd < 0) return true;
+            if(used) handOff();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            wake.notify_one();
+            flusher.join();
+
+            std::vector<uint8_t> tail(index.size() * Chip8ExecLog::INDEX_ENTRY_BYTES + Chip8ExecLog::FOOTER_BYTES);
+            uint8_t* p = tail.data();
+            for(const Checkpoint& c : index){
+                Chip8ExecLog::put64(p, c.instruction);
+                Chip8ExecLog::put64(p + 8, c.hash);
+                Chip8ExecLog::put64(p + 16, c.offset);
+                p += Chip8ExecLog::INDEX_ENTRY_BYTES;
+            }
+            Chip8ExecLog::put64(p, flushed);
+            Chip8ExecLog::put64(p + 8, index.size());
+            memcpy(p + 16, "C8XI", 4);
+            if(!writeAll(tail.data(), tail.size())) failed = true;
+
+#ifdef _WIN32
+            _close(fd);
+#else
+            ::close(fd);
+#endif
+            fd = -1;
+            for(auto& b : buffers) std::vector<uint8_t>().swap(b);
+            return !failed;
+        }
+
+    private:
+        int fd = -1;
+        uint32_t interval = 1;
+        std::vector<uint8_t> buffers[2];
+        uint8_t* active = nullptr;
+        size_t used = 0;
+        uint64_t flushed = 0;                       // Bytes handed to the flush thread so far
+        std::vector<Checkpoint> index;
+
+        std::thread flusher;
+        std::mutex mutex;
+        std::condition_variable wake, drained;
+        const uint8_t* pending = nullptr;           // Buffer being written, guarded by mutex
+        size_t pendingBytes = 0;
+        bool stop = false;
+        bool failed = false;
+
+        /// Give the active buffer to the flush thread and switch to the other one,
+        /// after the thread has finished with it
+        CHIP8_NOINLINE void handOff(){
+            std::unique_lock<std::mutex> lock(mutex);
+            drained.wait(lock, [&]{ return pendingBytes == 0; });
+            pending = active;
+            pendingBytes = used;
+            lock.unlock();
+            wake.notify_one();
+            active = active == buffers[0].data() ? buffers[1].data() : buffers[0].data();
+            flushed += used;
+            used = 0;
+        }
+
+        void flushLoop(){
+            std::unique_lock<std::mutex> lock(mutex);
+            for(;;){
+                wake.wait(lock, [&]{ return pendingBytes != 0 || stop; });
+                if(pendingBytes){
+                    const uint8_t* p = pending;
+                    size_t n = pendingBytes;
+                    lock.unlock();
+                    bool ok = writeAll(p, n);
+                    lock.lock();
+                    if(!ok) failed = true;
+                    pendingBytes = 0;
+                    drained.notify_one();
+                    continue;
+                }
+                return;
+            }
+        }
+
+        bool writeAll(const uint8_t* p, size_t n){
+            while(n){
+#ifdef _WIN32
+                int res = _write(fd, p, (unsigned)(n < (1u << 30) ? n : (1u << 30)));
+#else
+                ssize_t res = ::write(fd, p, n);
+#endif
+                if(res <= 0) return false;
+                p += res;
+                n -= (size_t)res;
+            }
+            return true;
+        }
+};
+
+/// Hooks policy that logs every instruction the machine executes:
+///     Chip8ExecLogger log(writer, emu);
+///     emu.runCycles(n, log); ...
+///     log.finish();
+/// An instruction's record is written at the next fetch, when its effects are
+/// visible, by diffing against a shadow of pc, I, sp and V0-VF. Construct it
+/// when the machine is where the log should start; anything that changes the
+/// machine between runCycles() calls other than setKeys() (loadState() and the
+/// like) breaks the diff chain.
+class Chip8ExecLogger : public Chip8NoHooks {
+    public:
+        Chip8ExecLogger(Chip8ExecLogWriter& writer, const Chip8& machine) : out(writer), emu(machine) {
+            checkpoint();
+        }
+
+        CHIP8_INLINE void onFetch(unsigned short pc, unsigned short op){
+            if(pending && !retireShort()) retire();
+            pending = true;
+            fetchPc = pc;
+            fetchOp = op;
+        }
+
+        /// Log the last instruction and a closing checkpoint. Call after the last
+        /// runCycles(), before closing the writer.
+        void finish(){
+            if(pending) retire();
+            pending = false;
+            if(count != lastCheckpoint) checkpoint();
+        }
+
+        uint64_t instructions() const { return count; }
+
+    private:
+        Chip8ExecLogWriter& out;
+        const Chip8& emu;
+        bool pending = false;
+        unsigned short fetchPc = 0, fetchOp = 0;
+        uint16_t nextPc = 0, I = 0;                 // Shadow of the machine after the last record
+        uint8_t sp = 0;
+        uint8_t V[16] = {};                         // V0-VF
+        uint64_t count = 0, lastCheckpoint = 0;
+        uint32_t opcodes[4096];                     // Last opcode logged per address, chip8LogEffects() above it; ~0 = none since the checkpoint
+
+        /// Inline record for what most instructions are: an opcode that changes
+        /// no more than Vx, VF and I (chip8LogEffects()), already logged at its
+        /// address, with a pc less than 64 bytes from the last record's
+        /// successor. Only the registers the opcode can change are compared.
+        /// Returns false, having changed nothing, for anything else.
+        CHIP8_INLINE bool retireShort(){
+            using namespace Chip8ExecLog;
+            unsigned pc = fetchPc, op = fetchOp;
+            uint32_t known = opcodes[pc & 0xFFF];
+            unsigned effects = known >> 16;
+            uint32_t jump = chip8Zigzag((int32_t)pc - (int32_t)nextPc);
+            if((known & 0xFFFF) != op || (effects & CHIP8_LOG_OTHER) || jump >= 0x80
+               || count + 1 - lastCheckpoint == out.checkpointInterval())
+                return false;
+            uint8_t* p = out.reserve();
+            uint8_t* flags = p++;
+            unsigned f = 0;
+            if(jump){
+                f = PC;
+                *p++ = (uint8_t)jump;
+            }
+            unsigned x = (op >> 8) & 15, mask = 0;
+            uint8_t vx = emu.readRegister(x), vf = emu.readRegister(15);
+            if((effects & CHIP8_LOG_VX) && vx != V[x]) mask = 1u << x;
+            if((effects & CHIP8_LOG_VF) && vf != V[15]) mask |= 0x8000;
+            if(mask & (mask - 1)){                  // Vx and VF, x < 15
+                f |= REGS;
+                put16(p, (uint16_t)mask);
+                p[2] = vx;
+                p[3] = vf;
+                p += 4;
+            }
+            else if(mask){
+                f |= REG;
+                p[0] = (uint8_t)(mask == 0x8000 ? 15 : x);
+                p[1] = mask == 0x8000 ? vf : vx;
+                p += 2;
+            }
+            V[x] = vx;                              // Either changed or already equal
+            V[15] = vf;
+            if((effects & CHIP8_LOG_I) && emu.getIndex() != I){
+                f |= INDEX;
+                p = chip8PutVarint(p, chip8Zigzag((int16_t)(uint16_t)(emu.getIndex() - I)));
+                I = emu.getIndex();
+            }
+            *flags = (uint8_t)f;
+            out.commit(p);
+            nextPc = (uint16_t)(pc + 2);
+            count++;
+            return true;
+        }
+
+        CHIP8_NOINLINE void retire(){
+            using namespace Chip8ExecLog;
+            uint8_t* p = out.reserve();
+            uint8_t* flags = p++;
+            unsigned f = 0;
+            unsigned pc = fetchPc, op = fetchOp;
+            if(pc != nextPc){
+                f |= PC;
+                p = chip8PutVarint(p, chip8Zigzag((int32_t)pc - (int32_t)nextPc));
+            }
+            nextPc = (uint16_t)(pc + 2);
+            if((opcodes[pc & 0xFFF] & 0xFFFF) != op || opcodes[pc & 0xFFF] == ~0u){
+                f |= OP;
+                *p++ = (uint8_t)(op >> 8);
+                *p++ = (uint8_t)op;
+                opcodes[pc & 0xFFF] = op | chip8LogEffects(op) << 16;
+            }
+            const unsigned char* reg = emu.getRegisters();
+            uint64_t lo, hi, regLo, regHi;
+            memcpy(&lo, reg, 8);
+            memcpy(&hi, reg + 8, 8);
+            memcpy(&regLo, V, 8);
+            memcpy(&regHi, V + 8, 8);
+            if((lo ^ regLo) | (hi ^ regHi)){
+                unsigned mask = chip8NonzeroBytes(lo ^ regLo) | chip8NonzeroBytes(hi ^ regHi) << 8;
+                if(!(mask & (mask - 1))){
+                    f |= REG;
+                    unsigned x = chip8LowestBit(mask);
+                    p[0] = (uint8_t)x;
+                    p[1] = reg[x];
+                    p += 2;
+                }
+                else{
+                    f |= REGS;
+                    put16(p, (uint16_t)mask);
+                    p += 2;
+                    for(unsigned m = mask; m; m &= m - 1) *p++ = reg[chip8LowestBit(m)];
+                }
+                memcpy(V, reg, 16);
+            }
+            uint16_t oldI = I;
+            if(emu.getIndex() != I){
+                f |= INDEX;
+                p = chip8PutVarint(p, chip8Zigzag((int16_t)(uint16_t)(emu.getIndex() - I)));
+                I = emu.getIndex();
+            }
+            if(emu.getStackPointer() != sp){
+                f |= SP;
+                sp = emu.getStackPointer();
+                *p++ = sp;
+            }
+            if((op & 0xF000) == 0xF000){
+                unsigned n = chip8MemoryWriteCount(op);
+                for(unsigned i = 0; i < n; i++) *p++ = emu.readMemory(oldI + i);
+            }
+            *flags = (uint8_t)f;
+            out.commit(p);
+            if(++count - lastCheckpoint == out.checkpointInterval()) checkpoint();
+        }
+
+        CHIP8_NOINLINE void checkpoint(){
+            using namespace Chip8ExecLog;
+            memset(opcodes, 0xFF, sizeof(opcodes));
+            nextPc = emu.getPC();
+            I = emu.getIndex();
+            sp = emu.getStackPointer();
+            memcpy(V, emu.getRegisters(), 16);
+            uint64_t hash = emu.stateHash();
+
+            uint8_t* p = out.reserve();
+            uint64_t at = out.offset();             // After reserve(), which may start a new buffer
+            *p++ = CHECKPOINT;
+            p = chip8PutVarint(p, count);
+            put64(p, hash);
+            put16(p + 8, nextPc);
+            put16(p + 10, I);
+            p[12] = sp;
+            memcpy(p + 13, emu.getRegisters(), 16);
+            out.commit(p + 29);
+            out.addCheckpoint(count, hash, at);
+            lastCheckpoint = count;
+        }
+};
+
+/// One decoded instruction
+struct Chip8ExecLogRecord {
+    uint64_t instruction;                           // 0-based position in the run
+    uint16_t pc, opcode;
+    uint16_t regMask;                               // V registers the instruction changed
+    uint8_t reg[16];                                // V0-VF after it
+    uint16_t I;                                     // After it
+    bool indexChanged, spChanged;
+    uint8_t sp;
+    uint16_t writeAddress;                          // Fx33/Fx55: I before the instruction
+    uint8_t writeCount;
+    uint8_t written[16];
+};
+
+/// Reads a finished log. The file is mapped where mmap exists (otherwise read
+/// whole), so only the index and the stretches actually decoded are paged in.
+/// seek() jumps to any checkpoint and next() decodes forward from there.
+class Chip8ExecLogReader {
+    public:
+        typedef Chip8ExecLogWriter::Checkpoint Checkpoint;
+
+        Chip8ExecLogReader() = default;
+        ~Chip8ExecLogReader(){ release(); }
+
+        Chip8ExecLogReader(const Chip8ExecLogReader&) = delete;
+        Chip8ExecLogReader& operator=(const Chip8ExecLogReader&) = delete;
+
+        /// False if path is missing, truncated (no footer: the run did not finish) or malformed
+        bool open(const char* path){
+            using namespace Chip8ExecLog;
+            release();
+            index.clear();
+            if(!map(path)) return false;
+
+            if(size < HEADER_BYTES + FOOTER_BYTES || memcmp(data, "C8XL", 4) || get16(data + 4) != VERSION) return false;
+            interval = get32(data + 8);
+            const uint8_t* footer = data + size - FOOTER_BYTES;
+            if(memcmp(footer + 16, "C8XI", 4)) return false;
+            uint64_t indexAt = get64(footer), entries = get64(footer + 8);
+            if(indexAt < HEADER_BYTES || indexAt > size - FOOTER_BYTES
+               || entries == 0 || entries != (size - FOOTER_BYTES - indexAt) / INDEX_ENTRY_BYTES) return false;
+            for(uint64_t i = 0; i < entries; i++){
+                const uint8_t* e = data + indexAt + i * INDEX_ENTRY_BYTES;
+                Checkpoint c{ get64(e), get64(e + 8), get64(e + 16) };
+                if(c.offset < HEADER_BYTES || c.offset >= indexAt) return false;
+                index.push_back(c);
+            }
+            recordsEnd = indexAt;
+            return seek(0);
+        }
+
+        const std::vector<Checkpoint>& checkpoints() const { return index; }
+        uint64_t instructions() const { return index.empty() ? 0 : index.back().instruction; }
+        uint64_t finalHash() const { return index.empty() ? 0 : index.back().hash; }
+        uint32_t checkpointInterval() const { return interval; }
+        size_t bytes() const { return size; }
+
+        /// Continue decoding at checkpoint k: the next record is instruction index[k].instruction
+        bool seek(size_t k){
+            if(k >= index.size()) return false;
+            pos = index[k].offset;
+            broken = data[pos] != Chip8ExecLog::CHECKPOINT;
+            return !broken;
+        }
+
+        /// Encoded bytes from checkpoint k up to the next one (or the end of the records)
+        const uint8_t* span(size_t k, size_t& n) const {
+            size_t end = k + 1 < index.size() ? index[k + 1].offset : recordsEnd;
+            n = end - index[k].offset;
+            return data + index[k].offset;
+        }
+
+        /// Decode the next instruction; false at the end or on a malformed record
+        bool next(Chip8ExecLogRecord& r){
+            using namespace Chip8ExecLog;
+            const uint8_t* p = data + pos;
+            const uint8_t* end = data + recordsEnd;
+            while(p < end && *p == CHECKPOINT){
+                p++;
+                if(!chip8GetVarint(p, end, at) || end - p < 29) return fail();
+                nextPc = get16(p + 8);
+                I = get16(p + 10);
+                sp = p[12];
+                memcpy(reg, p + 13, 16);
+                memset(opcodes, 0xFF, sizeof(opcodes));
+                p += 29;
+            }
+            pos = (size_t)(p - data);
+            if(p >= end) return false;
+
+            uint8_t f = *p++;
+            uint64_t v;
+            r.instruction = at++;
+            r.pc = nextPc;
+            if(f & PC){
+                if(!chip8GetVarint(p, end, v)) return fail();
+                r.pc = (uint16_t)(nextPc + chip8Unzigzag(v));
+            }
+            nextPc = (uint16_t)(r.pc + 2);
+            if(f & OP){
+                if(end - p < 2) return fail();
+                opcodes[r.pc & 0xFFF] = (uint32_t)(p[0] << 8 | p[1]);
+                p += 2;
+            }
+            if(opcodes[r.pc & 0xFFF] > 0xFFFF) return fail();
+            r.opcode = (uint16_t)opcodes[r.pc & 0xFFF];
+            r.regMask = 0;
+            if(f & REG){
+                if(end - p < 2 || p[0] > 15) return fail();
+                r.regMask = (uint16_t)(1u << p[0]);
+                reg[p[0]] = p[1];
+                p += 2;
+            }
+            else if(f & REGS){
+                if(end - p < 2) return fail();
+                r.regMask = get16(p);
+                p += 2;
+                for(unsigned m = r.regMask; m; m &= m - 1){
+                    if(p >= end) return fail();
+                    reg[chip8LowestBit(m)] = *p++;
+                }
+            }
+            memcpy(r.reg, reg, 16);
+            r.writeAddress = I;
+            r.indexChanged = (f & INDEX) != 0;
+            if(f & INDEX){
+                if(!chip8GetVarint(p, end, v)) return fail();
+                I = (uint16_t)(I + chip8Unzigzag(v));
+            }
+            r.I = I;
+            r.spChanged = (f & SP) != 0;
+            if(f & SP){
+                if(p >= end) return fail();
+                sp = *p++;
+            }
+            r.sp = sp;
+            r.writeCount = (uint8_t)chip8MemoryWriteCount(r.opcode);
+            if(end - p < r.writeCount) return fail();
+            memcpy(r.written, p, r.writeCount);
+            p += r.writeCount;
+            pos = (size_t)(p - data);
+            return true;
+        }
+
+        bool malformed() const { return broken; }
+
+    private:
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        bool mapped = false;
+        std::vector<uint8_t> copy;                  // Where the file could not be mapped
+        std::vector<Checkpoint> index;
+        uint32_t interval = 0;
+        size_t pos = 0, recordsEnd = 0;
+        bool broken = false;
+
+        // Decoding context, reset by every checkpoint record
+        uint64_t at = 0;
+        uint16_t nextPc = 0, I = 0;
+        uint8_t sp = 0;
+        uint8_t reg[16] = {};
+        uint32_t opcodes[4096];
+
+        bool fail(){
+            broken = true;
+            pos = recordsEnd;
+            return false;
+        }
+
+        bool map(const char* path){
+#ifndef _WIN32
+            int fd = ::open(path, O_RDONLY);
+            if(fd < 0) return false;
+            struct stat st;
+            if(fstat(fd, &st) == 0 && st.st_size > 0){
+                void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if(p != MAP_FAILED){
+                    data = static_cast<const uint8_t*>(p);
+                    size = (size_t)st.st_size;
+                    mapped = true;
+                }
+            }
+            ::close(fd);
+            if(mapped) return true;
+#endif
+            FILE* f = fopen(path, "rb");
+            if(!f) return false;
+            uint8_t buf[1 << 16];
+            size_t n;
+            while((n = fread(buf, 1, sizeof(buf), f)) > 0) copy.insert(copy.end(), buf, buf + n);
+            fclose(f);
+            data = copy.data();
+            size = copy.size();
+            return true;
+        }
+
+        void release(){
+#ifndef _WIN32
+            if(mapped) munmap(const_cast<uint8_t*>(data), size);
+#endif
+            mapped = false;
+            std::vector<uint8_t>().swap(copy);
+            data = nullptr;
+            size = 0;
+            pos = recordsEnd = 0;
+        }
+};
+
+/// Where two logs first disagree; see chip8FindDivergence()
+struct Chip8ExecLogDivergence {
+    enum Kind {
+        NONE,           // Same length and final state
+        INSTRUCTION,    // Records differ from `instruction` on
+        STATE,          // Hashes differ after agreeUntil, but no logged field does before `instruction` (keys, timers, display)
+        LENGTH,         // One run is a prefix of the other
+    };
+    Kind kind = NONE;
+    bool startDiffers = false;                      // Different seed or ROM: found by a linear scan
+    uint64_t agreeUntil = 0;                        // Last checkpoint where both state hashes match
+    uint64_t instruction = 0;
+    Chip8ExecLogRecord a{}, b{};                    // INSTRUCTION: both records of `instruction`
+    uint64_t hashesCompared = 0, recordsDecoded = 0;
+};
+
+inline bool chip8SameRecord(const Chip8ExecLogRecord& a, const Chip8ExecLogRecord& b){
+    return a.pc == b.pc && a.opcode == b.opcode && a.regMask == b.regMask && !memcmp(a.reg, b.reg, 16)
+        && a.I == b.I && a.sp == b.sp && a.writeCount == b.writeCount && !memcmp(a.written, b.written, a.writeCount);
+}
+
+/// First instruction where two runs of the same ROM and input split. Binary
+/// search over the checkpoints both logs share finds the last one whose state
+/// hashes match, then only the records up to the next shared checkpoint are
+/// decoded and compared: O(log checkpoints) hash compares plus one interval of
+/// records. This assumes runs that diverge stay diverged. A difference that
+/// leaves no trace in the state by the next checkpoint (a flag bit later
+/// overwritten) can be missed. With exact, the encoded bytes of every shared
+/// interval are compared instead, and only differing intervals are decoded:
+/// linear, but memcmp-fast. When the logs already differ at instruction 0
+/// there is nothing to bisect, and records are compared from the start.
+inline Chip8ExecLogDivergence chip8FindDivergence(Chip8ExecLogReader& a, Chip8ExecLogReader& b, bool exact = false){
+    Chip8ExecLogDivergence d;
+    const auto& ia = a.checkpoints();
+    const auto& ib = b.checkpoints();
+    std::vector<std::pair<size_t, size_t>> shared;  // Checkpoints at the same instruction in both logs
+    for(size_t i = 0, j = 0; i < ia.size() && j < ib.size(); ){
+        if(ia[i].instruction < ib[j].instruction) i++;
+        else if(ia[i].instruction > ib[j].instruction) j++;
+        else shared.push_back({ i++, j++ });
+    }
+    uint64_t shorter = a.instructions() < b.instructions() ? a.instructions() : b.instructions();
+    auto same = [&](size_t k){
+        d.hashesCompared++;
+        return ia[shared[k].first].hash == ib[shared[k].second].hash;
+    };
+
+    Chip8ExecLogRecord ra, rb;
+    auto compare = [&](uint64_t until){             // Records from the current positions up to `until`
+        while(a.next(ra) && b.next(rb) && ra.instruction < until){
+            d.recordsDecoded += 2;
+            if(chip8SameRecord(ra, rb)) continue;
+            d.kind = Chip8ExecLogDivergence::INSTRUCTION;
+            d.instruction = ra.instruction;
+            d.a = ra;
+            d.b = rb;
+            return true;
+        }
+        return false;
+    };
+
+    if(exact){
+        d.startDiffers = shared.empty() || !same(0);
+        for(size_t k = 0; k < shared.size(); k++){
+            size_t na, nb;
+            const uint8_t* pa = a.span(shared[k].first, na);
+            const uint8_t* pb = b.span(shared[k].second, nb);
+            bool whole = k + 1 < shared.size() && shared[k + 1].first == shared[k].first + 1
+                      && shared[k + 1].second == shared[k].second + 1;
+            if(whole && na == nb && !memcmp(pa, pb, na)){
+                d.agreeUntil = ia[shared[k + 1].first].instruction;
+                continue;
+            }
+            a.seek(shared[k].first);
+            b.seek(shared[k].second);
+            if(compare(k + 1 < shared.size() ? ia[shared[k + 1].first].instruction : shorter)) return d;
+        }
+        d.kind = a.instructions() != b.instructions() ? Chip8ExecLogDivergence::LENGTH
+               : a.finalHash() != b.finalHash() ? Chip8ExecLogDivergence::STATE : Chip8ExecLogDivergence::NONE;
+        d.instruction = shorter;
+        return d;
+    }
+
+    // Invariant: shared[lo] matches, shared[hi] (or the end) does not
+    size_t lo = 0, hi = shared.size(), fromA = 0, fromB = 0;
+    uint64_t until = shorter;                       // Compare records up to here
+    if(shared.empty() || !same(0)) d.startDiffers = true;
+    else{
+        while(hi - lo > 1){
+            size_t mid = lo + (hi - lo) / 2;
+            if(same(mid)) lo = mid;
+            else hi = mid;
+        }
+        d.agreeUntil = ia[shared[lo].first].instruction;
+        fromA = shared[lo].first;
+        fromB = shared[lo].second;
+        if(hi < shared.size()) until = ia[shared[hi].first].instruction;
+        else{
+            d.kind = a.instructions() == b.instructions() ? Chip8ExecLogDivergence::NONE : Chip8ExecLogDivergence::LENGTH;
+            d.instruction = shorter;
+            if(d.agreeUntil == shorter) return d;   // Else compare the tail after the last shared checkpoint
+        }
+    }
+
+    a.seek(fromA);
+    b.seek(fromB);
+    if(compare(until)) return d;
+    if(d.startDiffers || hi < shared.size()){
+        d.kind = Chip8ExecLogDivergence::STATE;
+        d.instruction = until;
+    }
+    return d;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+#include "chip8.h"
+
+/// Guest call-stack profiler for Chip8::nextCycle(Hooks&).
+/// Follows 2nnn/00EE with a shadow call tree and charges every executed
+/// instruction to the current guest stack. Output is Brendan Gregg's folded
+/// format ("main;sub_2D4;sub_300 123"), ready for flamegraph.pl.
+/// The tree is as deep as the core's 16-entry stack: calls past that are
+/// charged to the deepest frame, as the core overwrites its oldest return.
+class Chip8FlameProfiler : public Chip8NoHooks {
+    public:
+        static constexpr int MAX_DEPTH = 16;
+
+        Chip8FlameProfiler(){
+            nodes.push_back(Node{ 0, -1, -1, -1, 0, 0 });  // Root: code outside any subroutine
+        }
+
+        // Instructions are only counted here; they are charged to the current
+        // frame when the stack changes, which keeps the per-instruction cost
+        // to a single increment.
+        void onFetch(unsigned short pc, unsigned short op){
+            ticks++;
+        }
+
+        void onCall(unsigned short pc, unsigned short target){
+            Node* cur = &nodes[current];
+            cur->samples += ticks;
+            ticks = 0;
+            if(cur->depth == MAX_DEPTH){                    // Folded into this frame
+                overflow++;
+                return;
+            }
+
+            int child = cur->firstChild;
+            while(child >= 0 && nodes[child].addr != target)
+                child = nodes[child].nextSibling;
+            current = (child >= 0) ? child : addChild(target);
+        }
+
+        void onReturn(unsigned short pc, unsigned short target){
+            Node* cur = &nodes[current];
+            cur->samples += ticks;
+            ticks = 0;
+            if(overflow) overflow--;                        // Return from a folded call
+            else if(cur->parent >= 0)                       // Unbalanced 00EE stays at the root
+                current = cur->parent;
+        }
+
+        /// Load "ADDR NAME" lines (hex address, '#' comments) naming subroutines
+        bool loadSymbols(const char* path){
+            FILE* f = fopen(path, "r");
+            if(!f) return false;
+            char line[256];
+            while(fgets(line, sizeof(line), f)){
+                char name[200];
+                unsigned addr;
+                if(line[0] == '#') continue;
+                if(sscanf(line, "%x %199s", &addr, name) == 2)
+                    symbols[(unsigned short)addr] = name;
+            }
+            fclose(f);
+            return true;
+        }
+
+        /// Write one folded line per distinct guest stack
+        void writeFolded(FILE* out){
+            nodes[current].samples += ticks;
+            ticks = 0;
+            std::string path = "main";
+            writeNode(out, 0, path);
+        }
+
+    private:
+        struct Node {
+            unsigned short addr;                            // Subroutine entry
+            int parent, firstChild, nextSibling;
+            unsigned long long samples;                     // Instructions executed in this frame
+            int depth;                                      // Root is 0
+        };
+
+        std::vector<Node> nodes;
+        int current = 0;
+        unsigned long long ticks = 0;                       // Not yet charged to nodes[current]
+        unsigned long long overflow = 0;                    // Calls past MAX_DEPTH not yet returned from
+        std::map<unsigned short, std::string> symbols;
+
+        // Kept out of line so the hooks stay small enough for decode() to inline
+        CHIP8_NOINLINE int addChild(unsigned short target){
+            int child = (int)nodes.size();
+            nodes.push_back(Node{ target, current, -1, nodes[current].firstChild, 0, nodes[current].depth + 1 });
+            nodes[current].firstChild = child;
+            return child;
+        }
+
+        std::string label(unsigned short addr) const {
+            auto it = symbols.find(addr);
+            if(it != symbols.end()) return it->second;
+            char buf[16];
+            snprintf(buf, sizeof(buf), "sub_%03X", addr);
+            return buf;
+        }
+
+        /// Pre-order walk along parent/sibling links, so deep trees need no recursion
+        void writeNode(FILE* out, int n, std::string& path) const {
+            std::vector<size_t> lengths;                    // path length before each frame's label
+            for(;;){
+                if(nodes[n].samples)
+                    fprintf(out, "%s %llu\n", path.c_str(), nodes[n].samples);
+                int next = nodes[n].firstChild;
+                while(next < 0 && !lengths.empty()){        // Climb until a frame has a next sibling
+                    path.resize(lengths.back());
+                    lengths.pop_back();
+                    next = nodes[n].nextSibling;
+                    n = nodes[n].parent;
+                }
+                if(next < 0) return;
+                lengths.push_back(path.size());
+                path += ';';
+                path += label(nodes[next].addr);
+                n = next;
+            }
+        }
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "chip8.h"
+
+/// Detects a machine that provably loops forever.
+/// The core is deterministic: with the keypad unchanged, a machine whose
+/// complete state (registers, PC, I, stack, timers, keypad, RNG, memory and
+/// framebuffer) equals an earlier one will repeat the same run indefinitely.
+/// check() is called at regular points, e.g. every N frames. It keeps one
+/// anchor snapshot and compares against it Brent-style: the anchor moves to
+/// the current state after 1, 2, 4, ... checks. A loop of any length is
+/// therefore found within a few times its period, counted in checks. Checks
+/// made while a timer is still counting down are skipped.
+/// Call reset() whenever the keypad changes.
+class Chip8HangDetector {
+    public:
+        void reset() { anchored = false; }
+
+        /// True once the machine is in a proven loop
+        bool check(const Chip8& emu){
+            if(!emu.timersIdle()) return false;        // Skipped, not a reason to drop the anchor
+            if(!anchored){
+                emu.saveState(anchor, false);
+                anchored = true;
+                power = 1;
+                distance = 0;
+                return false;
+            }
+            distance++;
+            if(emu.matchesState(anchor)) return true;
+            if(distance == power){                      // Brent: move the anchor, double the window
+                emu.saveState(anchor, false);
+                power *= 2;
+                distance = 0;
+            }
+            return false;
+        }
+
+        /// After check() returned true: checks between the two equal states.
+        /// The loop's period in instructions divides loopChecks() * instructions per check.
+        unsigned long loopChecks() const { return distance; }
+
+    private:
+        Chip8State anchor;
+        bool anchored = false;
+        unsigned long power = 1;
+        unsigned long distance = 0;
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "chip8.h"
+
+/// Keypad state that takes effect at the start of a frame
+struct Chip8MovieEvent {
+    uint32_t frame;
+    uint16_t keys;                      // Bit i = key i pressed
+    uint16_t reserved;
+};
+
+/// Input movie: the seed, the ROM it was made on, and every keypad change
+/// keyed by frame number. gfxChain hashes the framebuffer after each frame,
+/// so a replay can prove it reproduced the exact same picture sequence.
+class Chip8Movie {
+    public:
+        static constexpr uint32_t MAGIC = 0x564D3843;   // "C8MV"
+        static constexpr uint16_t VERSION = 1;
+
+        uint64_t seed = 0;
+        Chip8Rng::Algorithm rng = Chip8Rng::PCG32;
+        uint64_t romHash = 0;           // Program area right after loading
+        uint32_t cyclesPerFrame = Chip8::CYCLES_PER_FRAME;
+        uint32_t frameCount = 0;
+        uint64_t gfxChain = 0;
+        std::vector<Chip8MovieEvent> events;
+
+        bool save(const char* path) const {
+            FILE* f = fopen(path, "wb");
+            if(!f) return false;
+            Header h{ MAGIC, VERSION, (uint16_t)rng, cyclesPerFrame, frameCount, seed, romHash, gfxChain,
+                      (uint32_t)events.size(), 0 };
+            bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+            if(ok && !events.empty())
+                ok = fwrite(events.data(), sizeof(Chip8MovieEvent), events.size(), f) == events.size();
+            return fclose(f) == 0 && ok;
+        }
+
+        /// Rejects files whose event count runs past the end of the file and
+        /// events out of frame order
+        bool load(const char* path){
+            FILE* f = fopen(path, "rb");
+            if(!f) return false;
+            fseek(f, 0, SEEK_END);
+            long size = ftell(f);
+            rewind(f);
+            Header h;
+            bool ok = size >= (long)sizeof(h) && fread(&h, sizeof(h), 1, f) == 1
+                   && h.magic == MAGIC && h.version == VERSION
+                   && (uint64_t)h.eventCount * sizeof(Chip8MovieEvent) <= (uint64_t)size - sizeof(h);
+            std::vector<Chip8MovieEvent> read;
+            if(ok){
+                read.resize(h.eventCount);
+                ok = h.eventCount == 0 ||
+                     fread(read.data(), sizeof(Chip8MovieEvent), h.eventCount, f) == h.eventCount;
+            }
+            fclose(f);
+            for(size_t i = 1; ok && i < read.size(); i++)
+                ok = read[i].frame >= read[i - 1].frame;
+            if(!ok) return false;
+            events.swap(read);
+            seed = h.seed;
+            rng = (Chip8Rng::Algorithm)h.rng;
+            romHash = h.romHash;
+            cyclesPerFrame = h.cyclesPerFrame;
+            frameCount = h.frameCount;
+            gfxChain = h.gfxChain;
+            return true;
+        }
+
+        /// Identity of the loaded program (0x200-0xFFF)
+        static uint64_t programHash(const Chip8& emu){
+            uint8_t program[4096 - 0x200];          // Local: recorders on several threads hash at once
+            for(unsigned a = 0x200; a < 4096; a++) program[a - 0x200] = emu.readMemory(a);
+            return chip8Hash(program, sizeof(program));
+        }
+
+    private:
+        struct Header {
+            uint32_t magic;
+            uint16_t version;
+            uint16_t rng;               // Chip8Rng::Algorithm
+            uint32_t cyclesPerFrame;
+            uint32_t frameCount;
+            uint64_t seed;
+            uint64_t romHash;
+            uint64_t gfxChain;
+            uint32_t eventCount;
+            uint32_t reserved1;
+        };
+};
+
+/// Drives a Chip8 one frame at a time while recording or replaying a movie.
+/// Usage: emu.init(movie.seed, movie.rng); emu.loadROM(...); session.start(emu); then
+/// session.frame(emu, keys) once per frame.
+class Chip8MovieSession {
+    public:
+        enum Mode { RECORD, PLAY };
+
+        Chip8MovieSession(Chip8Movie& m, Mode sessionMode) : movie(m), mode(sessionMode) {}
+
+        /// Call after init(movie.seed, movie.rng) and loading the ROM; false if a replay is for another ROM
+        bool start(const Chip8& emu){
+            frameIndex = 0;
+            chain = 0;
+            next = 0;
+            keys = 0;
+            uint64_t rom = Chip8Movie::programHash(emu);
+            if(mode == RECORD){
+                movie.romHash = rom;
+                movie.cyclesPerFrame = Chip8::CYCLES_PER_FRAME;
+                movie.events.clear();
+                return true;
+            }
+            return rom == movie.romHash;
+        }
+
+        /// Run one frame. liveKeys is recorded in RECORD mode and ignored in PLAY mode.
+        void frame(Chip8& emu, uint16_t liveKeys = 0){
+            Chip8NoHooks none;
+            frame(emu, liveKeys, none);
+        }
+
+        /// Run one frame with instrumentation hooks (see Chip8NoHooks)
+        template<class Hooks>
+        void frame(Chip8& emu, uint16_t liveKeys, Hooks& hooks){
+            if(mode == RECORD){
+                if(liveKeys != keys || frameIndex == 0){
+                    movie.events.push_back(Chip8MovieEvent{ frameIndex, liveKeys, 0 });
+                    keys = liveKeys;
+                }
+            }
+            else{
+                while(next < movie.events.size() && movie.events[next].frame <= frameIndex)
+                    keys = movie.events[next++].keys;
+            }
+            emu.setKeys(keys);
+            emu.runCycles(movie.cyclesPerFrame, hooks);
+            chain = (chain ^ chip8Hash(emu.getGfx(), 2048)) * 0x100000001B3ull;
+            chain ^= chain >> 29;
+            frameIndex++;
+        }
+
+        /// Close a recording, or check a replay against it
+        bool finish(){
+            if(mode == RECORD){
+                movie.frameCount = frameIndex;
+                movie.gfxChain = chain;
+                return true;
+            }
+            return frameIndex == movie.frameCount && chain == movie.gfxChain;
+        }
+
+        bool done() const { return mode == PLAY && frameIndex >= movie.frameCount; }
+        uint32_t frames() const { return frameIndex; }
+        uint64_t gfxChain() const { return chain; }
+
+    private:
+        Chip8Movie& movie;
+        Mode mode;
+        uint32_t frameIndex = 0;
+        uint64_t chain = 0;
+        size_t next = 0;
+        uint16_t keys = 0;
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Work-stealing thread pool for coarse, independent jobs (an emulator run,
+/// a search expansion). run() deals the job indices round-robin into one
+/// deque per worker; a worker pops from the back of its own deque and, once
+/// that is empty, steals from the front of the others. Jobs take milliseconds,
+/// so a mutex per deque costs nothing measurable and keeps the pool simple;
+/// each deque sits on its own cache line so workers never share one.
+/// Worker threads live as long as the pool and sleep between run() calls, so
+/// callers that run() once per frame or step pay no thread start-up.
+class Chip8Pool {
+    public:
+        /// threads = 0 uses every hardware thread
+        explicit Chip8Pool(unsigned threads = 0)
+            : count(threads ? threads : std::thread::hardware_concurrency()) {
+            if(count == 0) count = 1;
+            queues.reset(new Queue[count]);
+            for(unsigned w = 1; w < count; w++) workers.emplace_back([this, w]{ park(w); });
+        }
+
+        ~Chip8Pool(){
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stopping = true;
+            }
+            wake.notify_all();
+            for(auto& t : workers) t.join();
+        }
+
+        unsigned threads() const { return count; }
+        unsigned long long steals() const { return stolen; }   // Over all run() calls
+
+        /// Call fn(job, worker) for every job in [0, jobs); returns when all are done.
+        /// worker is in [0, threads()) and stable for the calling thread.
+        template<class F>
+        void run(size_t jobs, F fn){
+            for(size_t j = 0; j < jobs; j++) queues[j % count].jobs.push_back(j);
+            task = [](void* f, size_t job, unsigned w){ (*static_cast<F*>(f))(job, w); };
+            context = &fn;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                busy = count - 1;
+                generation++;
+            }
+            wake.notify_all();
+            work(0);                                // The caller is worker 0
+            std::unique_lock<std::mutex> guard(lock);
+            idle.wait(guard, [this]{ return busy == 0; });
+        }
+
+    private:
+        struct alignas(64) Queue {
+            std::mutex lock;
+            std::deque<size_t> jobs;
+        };
+
+        unsigned count;
+        std::unique_ptr<Queue[]> queues;
+        std::atomic<unsigned long long> stolen{0};
+        std::vector<std::thread> workers;           // Workers 1..count-1
+
+        std::mutex lock;                            // Guards the fields below
+        std::condition_variable wake, idle;
+        unsigned long long generation = 0;          // One per run() call
+        unsigned busy = 0;                          // Workers still on this run()
+        bool stopping = false;
+        void (*task)(void*, size_t, unsigned) = nullptr;
+        void* context = nullptr;
+
+        void work(unsigned w){
+            size_t job;
+            while(take(w, job)) task(context, job, w);
+        }
+
+        /// Worker thread body: one pass over the queues per run() call
+        void park(unsigned w){
+            unsigned long long seen = 0;
+            for(;;){
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    wake.wait(guard, [&]{ return stopping || generation != seen; });
+                    if(stopping) return;
+                    seen = generation;
+                }
+                work(w);
+                std::lock_guard<std::mutex> guard(lock);
+                if(--busy == 0) idle.notify_one();
+            }
+        }
+
+        /// Own work first, newest first; then the oldest job of another worker
+        bool take(unsigned w, size_t& job){
+            {
+                std::lock_guard<std::mutex> guard(queues[w].lock);
+                if(!queues[w].jobs.empty()){
+                    job = queues[w].jobs.back();
+                    queues[w].jobs.pop_back();
+                    return true;
+                }
+            }
+            for(unsigned k = 1; k < count; k++){
+                Queue& victim = queues[(w + k) % count];
+                std::lock_guard<std::mutex> guard(victim.lock);
+                if(!victim.jobs.empty()){
+                    job = victim.jobs.front();
+                    victim.jobs.pop_front();
+                    stolen++;
+                    return true;
+                }
+            }
+            return false;                           // Nothing is ever added mid-run, so all done
+        }
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include "chip8.h"
+
+/// Execution profiler for Chip8::nextCycle(Hooks&).
+/// Counts instructions per opcode class, hits per PC and DXYN pixels.
+/// Only code that passes a profiler to nextCycle/runCycles pays for it.
+class Chip8Profiler : public Chip8NoHooks {
+    public:
+        enum { OPCODE_CLASSES = 36 };                   // 35 instructions + unknown
+
+        unsigned long long classCount[OPCODE_CLASSES] = {};
+        unsigned long long pcHits[4096] = {};
+        unsigned long long draws = 0;                   // DXYN executed
+        unsigned long long pixels = 0;                  // Sprite pixels toggled
+        unsigned long long erased = 0;                  // Pixels turned off (collisions)
+
+        void onFetch(unsigned short pc, unsigned short op){
+            int cls = opcodeClass(op);
+            classCount[cls]++;
+            pcHits[pc & 0xFFF]++;
+            if(cls == DRW) draws++;
+        }
+
+        void onPixel(unsigned index, bool wasSet){
+            pixels++;
+            if(wasSet) erased++;
+        }
+
+        unsigned long long instructions() const {
+            unsigned long long n = 0;
+            for(int i = 0; i < OPCODE_CLASSES; i++) n += classCount[i];
+            return n;
+        }
+
+        /// Map an opcode to its instruction class (Cowgod numbering)
+        static int opcodeClass(unsigned short op){
+            unsigned x = op & 0x000F, kk = op & 0x00FF;
+            switch(op & 0xF000){
+                case 0x0000:
+                    if(kk == 0xE0) return CLS;                  // The core decodes 0x0 by its low byte
+                    if(kk == 0xEE) return RET;
+                    return SYS;
+                case 0x1000: return JP;
+                case 0x2000: return CALL;
+                case 0x3000: return SE_BYTE;
+                case 0x4000: return SNE_BYTE;
+                case 0x5000: return SE_REG;                     // Any low nibble: the core runs 5xyN as SE Vx, Vy
+                case 0x6000: return LD_BYTE;
+                case 0x7000: return ADD_BYTE;
+                case 0x8000:
+                    if(x <= 7) return LD_REG + x;
+                    return x == 0xE ? SHL : UNKNOWN;
+                case 0x9000: return x == 0 ? SNE_REG : UNKNOWN;
+                case 0xA000: return LD_I;
+                case 0xB000: return JP_V0;
+                case 0xC000: return RND;
+                case 0xD000: return DRW;
+                case 0xE000:
+                    if(kk == 0x9E) return SKP;
+                    if(kk == 0xA1) return SKNP;
+                    return UNKNOWN;
+                default:
+                    switch(kk){
+                        case 0x07: return LD_VX_DT;
+                        case 0x0A: return LD_VX_K;
+                        case 0x15: return LD_DT_VX;
+                        case 0x18: return LD_ST_VX;
+                        case 0x1E: return ADD_I;
+                        case 0x29: return LD_F;
+                        case 0x33: return LD_B;
+                        case 0x55: return LD_MEM_VX;
+                        case 0x65: return LD_VX_MEM;
+                    }
+                    return UNKNOWN;
+            }
+        }
+
+        static const char* className(int cls){
+            static const char* names[OPCODE_CLASSES] = {
+                "00E0 CLS", "00EE RET", "0nnn SYS", "1nnn JP", "2nnn CALL",
+                "3xkk SE", "4xkk SNE", "5xy0 SE", "6xkk LD", "7xkk ADD",
+                "8xy0 LD", "8xy1 OR", "8xy2 AND", "8xy3 XOR", "8xy4 ADD",
+                "8xy5 SUB", "8xy6 SHR", "8xy7 SUBN", "8xyE SHL", "9xy0 SNE",
+                "Annn LD I", "Bnnn JP V0", "Cxkk RND", "Dxyn DRW", "Ex9E SKP",
+                "ExA1 SKNP", "Fx07 LD DT", "Fx0A LD K", "Fx15 LD DT", "Fx18 LD ST",
+                "Fx1E ADD I", "Fx29 LD F", "Fx33 LD B", "Fx55 LD [I]", "Fx65 LD Vx",
+                "unknown"
+            };
+            return names[cls];
+        }
+
+        /// Dump all counters as JSON
+        void writeJson(FILE* out) const {
+            fprintf(out, "{\n  \"instructions\": %llu,\n  \"opcodes\": {", instructions());
+            bool first = true;
+            for(int i = 0; i < OPCODE_CLASSES; i++){
+                if(!classCount[i]) continue;
+                fprintf(out, "%s\n    \"%s\": %llu", first ? "" : ",", className(i), classCount[i]);
+                first = false;
+            }
+            fprintf(out, "\n  },\n  \"pc_hits\": {");
+            first = true;
+            for(int pc = 0; pc < 4096; pc++){
+                if(!pcHits[pc]) continue;
+                fprintf(out, "%s\n    \"0x%03X\": %llu", first ? "" : ",", pc, pcHits[pc]);
+                first = false;
+            }
+            fprintf(out, "\n  },\n  \"dxyn\": { \"draws\": %llu, \"pixels\": %llu, \"erased\": %llu }\n}\n",
+                    draws, pixels, erased);
+        }
+
+        /// Text report of the hottest opcode classes and addresses
+        void writeHotspots(FILE* out, int topPcs = 20) const {
+            double total = (double)instructions();
+            if(total == 0) total = 1;
+
+            std::vector<int> order;
+            for(int i = 0; i < OPCODE_CLASSES; i++) if(classCount[i]) order.push_back(i);
+            std::stable_sort(order.begin(), order.end(), [this](int a, int b){ return classCount[a] > classCount[b]; });
+
+            fprintf(out, "Opcode classes (%llu instructions)\n", instructions());
+            for(int cls : order)
+                fprintf(out, "  %-12s %14llu  %6.2f%%\n", className(cls), classCount[cls], 100.0 * classCount[cls] / total);
+
+            order.clear();
+            for(int pc = 0; pc < 4096; pc++) if(pcHits[pc]) order.push_back(pc);
+            std::stable_sort(order.begin(), order.end(), [this](int a, int b){ return pcHits[a] > pcHits[b]; });
+            if((int)order.size() > topPcs) order.resize(topPcs);
+
+            fprintf(out, "\nHottest addresses\n");
+            for(int pc : order)
+                fprintf(out, "  0x%03X        %14llu  %6.2f%%\n", pc, pcHits[pc], 100.0 * pcHits[pc] / total);
+
+            fprintf(out, "\nDXYN: %llu draws, %llu pixels, %llu erased\n", draws, pixels, erased);
+        }
+
+    private:
+        enum {
+            CLS, RET, SYS, JP, CALL, SE_BYTE, SNE_BYTE, SE_REG, LD_BYTE, ADD_BYTE,
+            LD_REG, OR, AND, XOR, ADD_REG, SUB, SHR, SUBN, SHL, SNE_REG,
+            LD_I, JP_V0, RND, DRW, SKP, SKNP, LD_VX_DT, LD_VX_K, LD_DT_VX, LD_ST_VX,
+            ADD_I, LD_F, LD_B, LD_MEM_VX, LD_VX_MEM, UNKNOWN
+        };
+};
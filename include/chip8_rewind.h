@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "chip8_state.h"
+
+/// Rewind history of Chip8State snapshots in a fixed-size byte ring.
+/// Every snapshot is stored as the XOR against its predecessor, run-length
+/// encoded over 64-bit words; XOR deltas undo themselves, so stepping back is
+/// one decode into the newest state. Every keyframeInterval snapshots the
+/// record also carries the full state, which lets peek() reach far-back
+/// frames without replaying the whole chain. Nothing is allocated after
+/// construction; the oldest records are evicted when the ring fills.
+class Chip8Rewind {
+    public:
+        explicit Chip8Rewind(size_t capacityBytes, unsigned keyframeInterval = 600)
+            : capacity(capacityBytes < 4 * sizeof(Chip8State) ? 4 * sizeof(Chip8State) : capacityBytes),
+              interval(keyframeInterval ? keyframeInterval : 1),
+              ring(new unsigned char[capacity]),
+              scratch(new unsigned char[MAX_ENCODED * 2]),
+              newest(new Chip8State()),
+              records(capacity / 16 + 1) {}
+
+        /// Append the state of the frame that just finished
+        void push(const Chip8State& s){
+            unsigned char* out = scratch.get();
+            Record r{};
+            if(count > 0){
+                r.deltaLen = encode(reinterpret_cast<const unsigned char*>(newest.get()),
+                                    reinterpret_cast<const unsigned char*>(&s), out);
+            }
+            if(count == 0 || ++sinceKey >= interval){
+                r.fullLen = encode(nullptr, reinterpret_cast<const unsigned char*>(&s), out + r.deltaLen);
+                sinceKey = 0;
+            }
+
+            size_t len = r.deltaLen + r.fullLen;
+            r.offset = (uint32_t)reserve(len);
+            memcpy(ring.get() + r.offset, out, len);
+            records[(head + count) % records.size()] = r;
+            count++;
+            writePos = r.offset + len;
+            *newest = s;
+        }
+
+        /// Drop the newest snapshot and return the one before it, or null at the
+        /// oldest retained frame. The pointer stays valid until the next push/stepBack.
+        const Chip8State* stepBack(){
+            if(count < 2) return nullptr;
+            const Record& r = records[(head + count - 1) % records.size()];
+            applyXor(reinterpret_cast<unsigned char*>(newest.get()), ring.get() + r.offset, r.deltaLen);
+            writePos = r.offset;
+            count--;
+            if(sinceKey > 0) sinceKey--;                    // Only the keyframe cadence; peek() does not rely on it
+            return newest.get();
+        }
+
+        /// Reconstruct the state framesBack snapshots before the newest without removing anything
+        bool peek(size_t framesBack, Chip8State& out) const {
+            if(framesBack >= count) return false;
+            size_t target = count - 1 - framesBack;
+
+            size_t from = count - 1;                        // Nearest keyframe at or after target
+            for(size_t i = target; i < count - 1; i++){
+                if(record(i).fullLen){ from = i; break; }
+            }
+
+            unsigned char* dst = reinterpret_cast<unsigned char*>(&out);
+            if(from == count - 1 && !record(from).fullLen){
+                out = *newest;
+            }
+            else{
+                const Record& k = record(from);
+                memset(dst, 0, sizeof(Chip8State));
+                applyXor(dst, ring.get() + k.offset + k.deltaLen, k.fullLen);
+            }
+            for(size_t i = from; i > target; i--){
+                const Record& r = record(i);
+                applyXor(dst, ring.get() + r.offset, r.deltaLen);
+            }
+            return true;
+        }
+
+        size_t frames() const { return count; }             // Snapshots retained
+        size_t capacityBytes() const { return capacity; }
+
+        size_t bytesUsed() const {
+            size_t n = 0;
+            for(size_t i = 0; i < count; i++) n += record(i).deltaLen + record(i).fullLen;
+            return n;
+        }
+
+        /// Ring bytes per second of retained gameplay
+        double bytesPerSecond(double framesPerSecond = 60.0) const {
+            return count ? bytesUsed() * framesPerSecond / count : 0.0;
+        }
+
+        void clear(){
+            count = head = writePos = 0;
+            sinceKey = 0;
+        }
+
+    private:
+        struct Record {
+            uint32_t offset;
+            uint32_t deltaLen;          // XOR against the previous snapshot (none for the first)
+            uint32_t fullLen;           // Keyframe, follows the delta
+        };
+
+        static constexpr size_t WORDS = sizeof(Chip8State) / 8;
+        static constexpr size_t MAX_ENCODED = sizeof(Chip8State) + 2 * WORDS + 16;
+
+        size_t capacity;
+        unsigned interval;
+        std::unique_ptr<unsigned char[]> ring;
+        std::unique_ptr<unsigned char[]> scratch;
+        std::unique_ptr<Chip8State> newest;                 // State of the newest record
+        std::vector<Record> records;                        // Circular, oldest at head
+        size_t head = 0, count = 0, writePos = 0;
+        unsigned sinceKey = 0;
+
+        const Record& record(size_t i) const { return records[(head + i) % records.size()]; }
+
+        // Find len contiguous free bytes after the newest record, evicting the oldest
+        size_t reserve(size_t len){
+            for(;;){
+                if(count == records.size()){ evict(); continue; }
+                if(count == 0){ writePos = 0; return 0; }
+                size_t oldest = records[head].offset;
+                if(writePos > oldest){
+                    if(len <= capacity - writePos) return writePos;
+                    if(len <= oldest) return 0;
+                }
+                else if(len <= oldest - writePos) return writePos;
+                evict();
+            }
+        }
+
+        void evict(){
+            head = (head + 1) % records.size();
+            count--;
+        }
+
+        static unsigned char* putVarint(unsigned char* p, size_t v){
+            while(v >= 0x80){ *p++ = (unsigned char)(v | 0x80); v >>= 7; }
+            *p++ = (unsigned char)v;
+            return p;
+        }
+
+        static const unsigned char* getVarint(const unsigned char* p, size_t& v){
+            v = 0;
+            for(int shift = 0; ; shift += 7){
+                unsigned char b = *p++;
+                v |= (size_t)(b & 0x7F) << shift;
+                if(!(b & 0x80)) return p;
+            }
+        }
+
+        static uint64_t word(const unsigned char* p, size_t i){
+            uint64_t w;
+            memcpy(&w, p + i * 8, 8);
+            return w;
+        }
+
+        // (zero words, literal words, literals...) runs of prev ^ cur; prev == nullptr means zeros
+        static uint32_t encode(const unsigned char* prev, const unsigned char* cur, unsigned char* out){
+            unsigned char* p = out;
+            size_t i = 0;
+            while(i < WORDS){
+                size_t zeros = 0;
+                while(i < WORDS && (word(cur, i) ^ (prev ? word(prev, i) : 0)) == 0){ zeros++; i++; }
+                size_t start = i;
+                while(i < WORDS && (word(cur, i) ^ (prev ? word(prev, i) : 0)) != 0) i++;
+                p = putVarint(p, zeros);
+                p = putVarint(p, i - start);
+                for(size_t j = start; j < i; j++){
+                    uint64_t x = word(cur, j) ^ (prev ? word(prev, j) : 0);
+                    memcpy(p, &x, 8);
+                    p += 8;
+                }
+            }
+            return (uint32_t)(p - out);
+        }
+
+        static void applyXor(unsigned char* dst, const unsigned char* in, size_t len){
+            const unsigned char* end = in + len;
+            size_t i = 0;
+            while(in < end){
+                size_t zeros, literals;
+                in = getVarint(in, zeros);
+                in = getVarint(in, literals);
+                i += zeros;
+                for(size_t j = 0; j < literals; j++, i++, in += 8){
+                    uint64_t x;
+                    memcpy(&x, in, 8);
+                    x ^= word(dst, i);
+                    memcpy(dst + i * 8, &x, 8);
+                }
+            }
+        }
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+
+/// Per-instance random number generator for Cxkk.
+/// Each Chip8 owns one, so instances never share state or take a lock.
+/// The algorithm is selectable:
+///   PCG32       - default (O'Neill, XSH-RR)
+///   XOSHIRO128  - xoshiro128++ (Blackman/Vigna), seeded through splitmix64
+///   GLIBC       - the TYPE_3 additive generator behind glibc's srand()/rand(),
+///                 so a seed reproduces runs made with the old global rand()
+/// Plain data with a fixed size; it is copied verbatim into Chip8State.
+struct Chip8Rng {
+    enum Algorithm : uint32_t { PCG32 = 0, XOSHIRO128 = 1, GLIBC = 2 };
+
+    uint32_t s[32];                     // Generator state, layout depends on algorithm
+    uint32_t index;                     // GLIBC rear position in the 31-word ring
+    uint32_t algorithm;
+
+    void seed(uint64_t seedValue, Algorithm alg = PCG32){
+        for(int i = 0; i < 32; i++) s[i] = 0;
+        index = 0;
+        algorithm = alg;
+
+        switch(alg){
+            case XOSHIRO128: {
+                uint64_t x = seedValue;
+                for(int i = 0; i < 4; i += 2){
+                    uint64_t z = splitmix64(x);
+                    s[i] = (uint32_t)z;
+                    s[i + 1] = (uint32_t)(z >> 32);
+                }
+                break;
+            }
+            case GLIBC: {
+                // srand(seed): Park-Miller fill of 31 words, then discard 310 outputs
+                int32_t r[31];
+                r[0] = (int32_t)(uint32_t)seedValue;
+                if(r[0] == 0) r[0] = 1;
+                for(int i = 1; i < 31; i++){
+                    int32_t hi = r[i - 1] / 127773, lo = r[i - 1] % 127773;
+                    int32_t word = 16807 * lo - 2836 * hi;
+                    r[i] = word < 0 ? word + 2147483647 : word;
+                }
+                for(int i = 0; i < 31; i++) s[i] = (uint32_t)r[i];
+                for(int i = 0; i < 310; i++) next();
+                break;
+            }
+            default: {
+                uint64_t state = 0, inc = (0x2C8ull << 1) | 1;
+                setPcg(state, inc);
+                next();
+                getPcg(state, inc);
+                setPcg(state + seedValue, inc);
+                next();
+                break;
+            }
+        }
+    }
+
+    uint32_t next(){
+        switch(algorithm){
+            case XOSHIRO128: {
+                uint32_t result = rotl(s[0] + s[3], 7) + s[0];
+                uint32_t t = s[1] << 9;
+                s[2] ^= s[0];
+                s[3] ^= s[1];
+                s[1] ^= s[2];
+                s[0] ^= s[3];
+                s[2] ^= t;
+                s[3] = rotl(s[3], 11);
+                return result;
+            }
+            case GLIBC: {
+                // r[i] = r[i-31] + r[i-3]; index is glibc's rear pointer, front is 3 ahead
+                uint32_t front = index + 3 >= 31 ? index + 3 - 31 : index + 3;
+                uint32_t value = s[front] += s[index];
+                index = index + 1 >= 31 ? 0 : index + 1;
+                return value >> 1;
+            }
+            default: {
+                uint64_t old, inc;
+                getPcg(old, inc);
+                setPcg(old * 6364136223846793005ull + inc, inc);
+                uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+                uint32_t rot = (uint32_t)(old >> 59);
+                return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+            }
+        }
+    }
+
+    private:
+        static uint32_t rotl(uint32_t x, int k){ return (x << k) | (x >> (32 - k)); }
+
+        static uint64_t splitmix64(uint64_t& x){
+            uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        void getPcg(uint64_t& state, uint64_t& inc) const {
+            state = (uint64_t)s[1] << 32 | s[0];
+            inc = (uint64_t)s[3] << 32 | s[2];
+        }
+
+        void setPcg(uint64_t state, uint64_t inc){
+            s[0] = (uint32_t)state; s[1] = (uint32_t)(state >> 32);
+            s[2] = (uint32_t)inc;   s[3] = (uint32_t)(inc >> 32);
+        }
+};
+
+static_assert(sizeof(Chip8Rng) == 136, "Chip8Rng is stored verbatim in Chip8State");
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include "chip8.h"
+#include "chip8_pool.h"
+
+/// Lock-free set of 64-bit state hashes (open addressing, linear probing).
+/// insert() is safe from any number of threads. When the table is nearly full
+/// it stops deduplicating rather than blocking: every insert reports "new".
+class Chip8StateTable {
+    public:
+        explicit Chip8StateTable(unsigned bits) : mask((size_t(1) << bits) - 1), slots(new std::atomic<uint64_t>[mask + 1]) {
+            for(size_t i = 0; i <= mask; i++) slots[i].store(0, std::memory_order_relaxed);
+        }
+
+        /// True if hash was not in the table yet
+        bool insert(uint64_t hash){
+            if(hash == 0) hash = 1;                         // 0 marks an empty slot
+            size_t i = (size_t)(hash ^ (hash >> 29)) & mask;
+            for(size_t probe = 0; probe < 64; probe++, i = (i + 1) & mask){
+                uint64_t seen = slots[i].load(std::memory_order_relaxed);
+                if(seen == hash) return false;
+                if(seen == 0){
+                    if(slots[i].compare_exchange_strong(seen, hash, std::memory_order_relaxed)){
+                        count.fetch_add(1, std::memory_order_relaxed);
+                        return true;
+                    }
+                    if(seen == hash) return false;          // Another thread stored the same state
+                }
+            }
+            return true;                                    // Crowded: treat as new
+        }
+
+        size_t size() const { return count.load(std::memory_order_relaxed); }
+        size_t capacity() const { return mask + 1; }
+
+    private:
+        size_t mask;
+        std::unique_ptr<std::atomic<uint64_t>[]> slots;
+        std::atomic<size_t> count{0};
+};
+
+/// What the search is looking for, evaluated on a machine
+struct Chip8SearchGoal {
+    enum Kind { MEMORY, REGISTER, SPRITE };
+    enum Compare { EQ, NE, LT, LE, GT, GE };
+
+    Kind kind = MEMORY;
+    Compare compare = GE;
+    unsigned address = 0;           // Memory address or register number
+    int value = 0;
+    unsigned x = 0, y = 0;          // SPRITE: top-left corner and pattern (1 = lit)
+    unsigned width = 0, height = 0;
+    std::vector<uint8_t> pattern;
+
+    bool reached(const Chip8& s) const {
+        if(kind == SPRITE) return spriteMatches(s) == width * height;
+        int v = current(s);
+        switch(compare){
+            case EQ: return v == value;
+            case NE: return v != value;
+            case LT: return v < value;
+            case LE: return v <= value;
+            case GT: return v > value;
+            default: return v >= value;
+        }
+    }
+
+    /// Higher is closer to the goal; drives beam and best-first search
+    double score(const Chip8& s) const {
+        if(kind == SPRITE) return spriteMatches(s);
+        int v = current(s);
+        switch(compare){
+            case EQ: return -std::abs(v - value);
+            case LT: case LE: return -v;
+            case NE: return v != value;
+            default: return v;
+        }
+    }
+
+    private:
+        int current(const Chip8& s) const {
+            return kind == REGISTER ? s.readRegister(address) : s.readMemory(address);
+        }
+
+        unsigned spriteMatches(const Chip8& s) const {
+            const unsigned char* gfx = s.getGfx();
+            unsigned hits = 0;
+            for(unsigned r = 0; r < height; r++)
+                for(unsigned c = 0; c < width; c++)
+                    hits += gfx[((y + r) % 32) * 64 + (x + c) % 64] == pattern[r * width + c];
+            return hits;
+        }
+};
+
+/// Search over input sequences: a node is a machine snapshot, an edge holds
+/// one keypad mask for framesPerStep frames. Children are deduplicated on
+/// Chip8::stateHash() through a shared Chip8StateTable. Each parent's
+/// expansion is one job on a Chip8Pool, and a worker branches by restoring
+/// the parent snapshot into its own Chip8. Nodes are parked (Chip8Parked)
+/// against the root, so each holds only the pages it changed.
+///   BFS        - level by level; finds a shortest input sequence
+///   BEAM       - level by level, keeping the beamWidth best-scoring children
+///   BEST_FIRST - repeatedly expands the best-scoring open nodes, a batch at a time
+class Chip8Search {
+    public:
+        enum Mode { BFS, BEAM, BEST_FIRST };
+
+        struct Options {
+            Mode mode = BFS;
+            unsigned framesPerStep = 1;
+            unsigned beamWidth = 1000;
+            unsigned maxDepth = 600;
+            size_t maxExpanded = 1000000;
+            size_t maxOpen = 100000;                    // Snapshots held at once
+            unsigned tableBits = 22;
+            unsigned threads = 0;                       // 0 = all hardware threads
+            std::vector<uint16_t> actions;              // Empty = no key, then each key alone
+        };
+
+        struct Result {
+            bool found = false;
+            std::vector<uint16_t> path;                 // Keypad mask per step, root first
+            unsigned long long expanded = 0;            // Parents expanded
+            unsigned long long generated = 0;           // Children emulated
+            unsigned long long duplicates = 0;          // Children already in the table
+            unsigned long long kept = 0;                // Children stored as new nodes
+            unsigned long long keptBytes = 0;           // Their Chip8Parked::residentBytes()
+            double seconds = 0;
+            double nodesPerSecond() const { return seconds > 0 ? expanded / seconds : 0; }
+        };
+
+        /// Search from root's current state
+        static Result run(const Chip8& root, const Chip8SearchGoal& goal, Options opt){
+            if(opt.actions.empty()){
+                opt.actions.push_back(0);
+                for(unsigned k = 0; k < 16; k++) opt.actions.push_back((uint16_t)(1u << k));
+            }
+            if(opt.maxDepth > 0xFFFF) opt.maxDepth = 0xFFFF;
+            Search search(goal, opt);
+            return search.run(root);
+        }
+
+    private:
+        struct Node {
+            Chip8Parked parked;
+            uint32_t id;                                // Index into Search::meta
+            double score;
+            bool reached;
+        };
+
+        struct Meta {
+            uint32_t parent;
+            uint16_t action;
+            uint16_t depth;                             // Steps from the root
+        };
+
+        class Search {
+            public:
+                Search(const Chip8SearchGoal& g, const Options& o)
+                    : goal(g), opt(o), table(o.tableBits), pool(o.threads), workers(pool.threads()) {}
+
+                Result run(const Chip8& root){
+                    auto t0 = std::chrono::steady_clock::now();
+                    std::vector<Node> open(1);
+                    Chip8 emu(false);
+                    root.saveState(base, false);
+                    emu.loadState(base, false);
+                    emu.setKeys(0);
+                    emu.checkpoint(base);
+                    table.insert(emu.stateHash());
+                    emu.park(open[0].parked, base);
+                    open[0].id = 0;
+                    open[0].score = goal.score(emu);
+                    meta.push_back(Meta{ 0, 0, 0 });
+
+                    if(goal.reached(emu)) found = 0;
+                    else if(opt.mode == BEST_FIRST) bestFirst(open);
+                    else levels(open);
+
+                    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+                    if(found != NONE){
+                        result.found = true;
+                        for(uint32_t n = found; n != 0; n = meta[n].parent) result.path.push_back(meta[n].action);
+                        std::reverse(result.path.begin(), result.path.end());
+                    }
+                    return result;
+                }
+
+            private:
+                static constexpr uint32_t NONE = 0xFFFFFFFF;
+
+                struct alignas(64) Worker {
+                    Chip8 emu{ false };
+                    std::vector<Node> children;
+                    std::vector<uint32_t> parentOf;         // Per child: index into the batch
+                    std::vector<uint16_t> actionOf;
+                    unsigned long long generated = 0, duplicates = 0;
+                };
+
+                const Chip8SearchGoal& goal;
+                Options opt;
+                Chip8State base;                            // Root; every node is parked against it
+                Chip8StateTable table;
+                Chip8Pool pool;
+                std::vector<Worker> workers;
+                std::vector<Meta> meta;                     // Every node ever kept; id 0 is the root
+                Result result;
+                uint32_t found = NONE;
+
+                /// Expand batch[0..count) in parallel; children land in the workers' buffers
+                void expand(const std::vector<Node>& batch, size_t count){
+                    for(Worker& w : workers){
+                        w.children.clear();
+                        w.parentOf.clear();
+                        w.actionOf.clear();
+                    }
+                    pool.run(count, [&](size_t p, unsigned wi){
+                        Worker& w = workers[wi];
+                        for(uint16_t action : opt.actions){
+                            w.emu.unpark(batch[p].parked);
+                            w.emu.setKeys(action);
+                            w.emu.runCycles((unsigned long)opt.framesPerStep * Chip8::CYCLES_PER_FRAME);
+                            w.emu.setKeys(0);               // Keys are set again on every edge: not part of the node
+                            w.generated++;
+                            if(!table.insert(w.emu.stateHash())){
+                                w.duplicates++;
+                                continue;
+                            }
+                            w.children.emplace_back();
+                            Node& child = w.children.back();
+                            w.emu.park(child.parked, base);
+                            child.score = goal.score(w.emu);
+                            child.reached = goal.reached(w.emu);
+                            w.parentOf.push_back((uint32_t)p);
+                            w.actionOf.push_back(action);
+                        }
+                    });
+                    result.expanded += count;
+                }
+
+                /// Move the workers' children into out, numbering them; notes the first goal hit
+                void collect(const std::vector<Node>& batch, std::vector<Node>& out){
+                    for(Worker& w : workers){
+                        for(size_t c = 0; c < w.children.size(); c++){
+                            Node& child = w.children[c];
+                            child.id = (uint32_t)meta.size();
+                            uint32_t parent = batch[w.parentOf[c]].id;
+                            meta.push_back(Meta{ parent, w.actionOf[c], (uint16_t)(meta[parent].depth + 1) });
+                            if(found == NONE && child.reached) found = child.id;
+                            result.kept++;
+                            result.keptBytes += child.parked.residentBytes();
+                            out.push_back(std::move(child));
+                        }
+                        result.generated += w.generated;
+                        result.duplicates += w.duplicates;
+                        w.generated = w.duplicates = 0;
+                    }
+                }
+
+                static bool better(const Node& a, const Node& b) { return a.score > b.score; }
+
+                void levels(std::vector<Node>& frontier){
+                    for(unsigned depth = 0; depth < opt.maxDepth && !frontier.empty(); depth++){
+                        if(result.expanded + frontier.size() > opt.maxExpanded)
+                            frontier.resize(opt.maxExpanded - result.expanded);
+                        expand(frontier, frontier.size());
+                        std::vector<Node> next;
+                        collect(frontier, next);
+                        if(found != NONE || result.expanded >= opt.maxExpanded) return;
+
+                        size_t keep = opt.mode == BEAM ? opt.beamWidth : opt.maxOpen;
+                        if(next.size() > keep){
+                            std::partial_sort(next.begin(), next.begin() + keep, next.end(), better);
+                            next.resize(keep);
+                        }
+                        frontier.swap(next);
+                    }
+                }
+
+                void bestFirst(std::vector<Node>& open){
+                    // open is a max-heap on score; each round expands the best few per thread
+                    const size_t batchSize = 64 * (size_t)pool.threads();
+                    std::vector<Node> batch, children;
+                    auto lower = [](const Node& a, const Node& b){ return a.score < b.score; };
+                    std::make_heap(open.begin(), open.end(), lower);
+                    while(!open.empty() && result.expanded < opt.maxExpanded){
+                        batch.clear();
+                        while(!open.empty() && batch.size() < batchSize){
+                            std::pop_heap(open.begin(), open.end(), lower);
+                            batch.push_back(std::move(open.back()));
+                            open.pop_back();
+                        }
+                        expand(batch, batch.size());
+                        children.clear();
+                        collect(batch, children);
+                        if(found != NONE) return;
+                        for(Node& c : children){
+                            if(meta[c.id].depth >= opt.maxDepth) continue;
+                            open.push_back(std::move(c));
+                            std::push_heap(open.begin(), open.end(), lower);
+                        }
+                        if(open.size() > opt.maxOpen){                 // Drop the worst
+                            std::sort_heap(open.begin(), open.end(), lower);
+                            open.erase(open.begin(), open.begin() + (open.size() - opt.maxOpen));
+                            std::make_heap(open.begin(), open.end(), lower);
+                        }
+                    }
+                }
+        };
+};
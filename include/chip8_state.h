@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// Fixed-layout snapshot of a Chip8 machine.
+/// The blob is plain data in host (little-endian) byte order: it can be
+/// memcpy'd, written with fwrite and used in place from an mmapped file.
+/// Bump VERSION whenever the payload layout changes. memory and gfx sit on
+/// 64-byte boundaries, like their Chip8 counterparts, so the copies in
+/// saveState/loadState run at full memcpy speed.
+struct alignas(64) Chip8State {
+    static constexpr uint32_t MAGIC = 0x53533843;       // "C8SS"
+    static constexpr uint16_t VERSION = 4;             // 2: Cxkk generator, 3: selectable generator, 4: Zobrist hashes
+
+    // Header
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved0;
+    uint32_t size;                  // sizeof(Chip8State)
+    uint32_t reserved1;
+    uint64_t checksum;              // Over the payload (everything below)
+    uint8_t  reserved2[40];
+
+    // Payload
+    uint8_t  memory[4096];
+    uint8_t  gfx[2048];
+    uint8_t  rng[136];              // Chip8Rng, verbatim
+    uint16_t stack[16];
+    uint8_t  reg[16];
+    uint8_t  key[16];
+    uint16_t I;
+    uint16_t pc;
+    uint16_t opcode;
+    uint8_t  sp;                    // Any value: the core indexes stack[sp & 15]
+    uint8_t  delayTimer;
+    uint8_t  soundTimer;
+    uint8_t  drawFlag;
+    uint8_t  padding0[6];
+    uint64_t zobristMemory;         // Incremental hashes at save time (chip8_zobrist.h)
+    uint64_t zobristGfx;
+    uint8_t  padding[24];           // Explicit, so the checksum never sees tail padding
+
+    static constexpr size_t PAYLOAD_OFFSET = 64;
+
+    /// Fletcher-style sums over four interleaved lanes of 64-bit words;
+    /// catches corruption, not tampering. The lanes keep it vectorizable.
+    uint64_t computeChecksum() const {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(this) + PAYLOAD_OFFSET;
+        const size_t groups = (sizeof(Chip8State) - PAYLOAD_OFFSET) / 32;
+        uint64_t a[4] = {}, b[4] = {};
+        for(size_t i = 0; i < groups; i++){
+            uint64_t w[4];
+            memcpy(w, p + i * 32, 32);
+            for(int k = 0; k < 4; k++){
+                a[k] += w[k];
+                b[k] += a[k];
+            }
+        }
+        uint64_t sum = 0;
+        for(int k = 0; k < 4; k++){
+            sum ^= a[k] * (2 * k + 1);
+            sum = (sum << 13 | sum >> 51) + (b[k] << 32 | b[k] >> 32);
+        }
+        return sum;
+    }
+
+    void seal(){
+        magic = MAGIC;
+        version = VERSION;
+        reserved0 = 0;
+        size = sizeof(Chip8State);
+        reserved1 = 0;
+        memset(reserved2, 0, sizeof(reserved2));
+        checksum = computeChecksum();
+    }
+
+    /// Header matches this build and the payload is intact
+    bool valid() const {
+        return magic == MAGIC && version == VERSION && size == sizeof(Chip8State)
+            && checksum == computeChecksum();
+    }
+};
+
+static_assert((sizeof(Chip8State) - Chip8State::PAYLOAD_OFFSET) % 32 == 0, "Checksum works on 32-byte groups");
+static_assert(sizeof(Chip8State) == 6464, "Chip8State layout changed; bump VERSION");
+static_assert(offsetof(Chip8State, memory) == Chip8State::PAYLOAD_OFFSET, "Chip8State header changed");
+static_assert(offsetof(Chip8State, zobristMemory) % 8 == 0, "Chip8State hashes misaligned");
+
+/// Compact copy of a machine at rest: the registers plus only the 64-byte
+/// memory pages and framebuffer rows that differ from a base snapshot shared
+/// by many parked instances, so a ROM's code and font pages exist once. See
+/// Chip8::park/unpark. The base must outlive every Chip8Parked made from it.
+struct Chip8Parked {
+    const Chip8State* base = nullptr;
+    uint64_t memoryPages = 0;       // Bit p set: memory[p * 64, p * 64 + 64) is in pages
+    uint32_t gfxPages = 0;          // Bit r set: framebuffer row r is in pages
+    std::vector<uint8_t> pages;     // Stored memory pages in address order, then rows
+    uint8_t  rng[136];
+    uint16_t stack[16];
+    uint8_t  reg[16];
+    uint8_t  key[16];
+    uint16_t I;
+    uint16_t pc;
+    uint16_t opcode;
+    uint8_t  sp;
+    uint8_t  delayTimer;
+    uint8_t  soundTimer;
+    uint8_t  drawFlag;
+    uint64_t zobristMemory;
+    uint64_t zobristGfx;
+
+    /// Bytes this instance holds on its own (the shared base not included)
+    size_t residentBytes() const { return sizeof(*this) + pages.capacity(); }
+};
+
+/// Fast 64-bit hash (four multiply-xor lanes over 64-bit words); not cryptographic
+inline uint64_t chip8Hash(const void* data, size_t len){
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const uint64_t K = 0x9E3779B97F4A7C15ull;
+    uint64_t h[4] = { K, K ^ 1, K ^ 2, K ^ 3 };
+    size_t i = 0;
+    for(; i + 32 <= len; i += 32){
+        uint64_t w[4];
+        memcpy(w, p + i, 32);
+        for(int k = 0; k < 4; k++) h[k] = (h[k] ^ w[k]) * 0xFF51AFD7ED558CCDull;
+    }
+    uint64_t r = len;
+    for(int k = 0; k < 4; k++) r = (r ^ h[k] ^ (h[k] >> 29)) * 0xC4CEB9FE1A85EC53ull;
+    for(; i < len; i++) r = (r ^ p[i]) * 0x100000001B3ull;
+    return r ^ (r >> 32);
+}
+
+/// Write a snapshot to disk
+inline bool writeChip8State(const char* path, const Chip8State& s){
+    FILE* f = fopen(path, "wb");
+    if(!f) return false;
+    bool ok = fwrite(&s, sizeof(s), 1, f) == 1;
+    return fclose(f) == 0 && ok;
+}
+
+/// Read-only view of a snapshot file. Mapped in place where mmap exists,
+/// otherwise read into memory. state() is null if the file is not a valid
+/// snapshot for this build.
+class Chip8StateFile {
+    public:
+        explicit Chip8StateFile(const char* path){
+#ifndef _WIN32
+            int fd = open(path, O_RDONLY);
+            if(fd < 0) return;
+            struct stat st;
+            if(fstat(fd, &st) == 0 && (size_t)st.st_size == sizeof(Chip8State)){
+                void* p = mmap(nullptr, sizeof(Chip8State), PROT_READ, MAP_PRIVATE, fd, 0);
+                if(p != MAP_FAILED) mapped = static_cast<const Chip8State*>(p);
+            }
+            close(fd);
+#else
+            FILE* f = fopen(path, "rb");
+            if(!f) return;
+            Chip8State* s = new Chip8State;
+            if(fread(s, sizeof(*s), 1, f) == 1) mapped = s;
+            else delete s;
+            fclose(f);
+#endif
+            if(mapped && !mapped->valid()){
+                release();
+            }
+        }
+
+        ~Chip8StateFile(){ release(); }
+
+        Chip8StateFile(const Chip8StateFile&) = delete;
+        Chip8StateFile& operator=(const Chip8StateFile&) = delete;
+
+        const Chip8State* state() const { return mapped; }
+
+    private:
+        const Chip8State* mapped = nullptr;
+
+        void release(){
+            if(!mapped) return;
+#ifndef _WIN32
+            munmap(const_cast<Chip8State*>(mapped), sizeof(Chip8State));
+#else
+            delete mapped;
+#endif
+            mapped = nullptr;
+        }
+};
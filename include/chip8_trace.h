@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/// Scoped timeline spans exported as Chrome/Perfetto trace-event JSON.
+/// Each thread records into its own fixed-size ring, allocated on the
+/// thread's first span; when tracing is off a span costs one relaxed load.
+class Chip8Trace {
+    public:
+        static constexpr size_t EVENTS_PER_THREAD = 1 << 16;
+
+        struct Event {
+            const char* name;           // Must be a string literal
+            uint64_t start;             // ns since the trace epoch
+            uint64_t duration;          // ns
+        };
+
+        static void enable(bool on){ enabledFlag().store(on, std::memory_order_relaxed); }
+        static bool enabled(){ return enabledFlag().load(std::memory_order_relaxed); }
+
+        static uint64_t now(){
+            return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - epoch()).count();
+        }
+
+        static void record(const char* name, uint64_t start, uint64_t end){
+            Buffer& b = threadBuffer();
+            b.events[b.count % EVENTS_PER_THREAD] = Event{ name, start, end - start };
+            b.count++;
+        }
+
+        /// Write every recorded span; call while the recording threads are idle
+        static bool writeJson(const char* path){
+            FILE* f = fopen(path, "w");
+            if(!f) return false;
+
+            std::lock_guard<std::mutex> lock(registryMutex());
+            fprintf(f, "{\"traceEvents\":[\n");
+            bool first = true;
+            for(const auto& b : registry()){
+                uint64_t n = b->count < EVENTS_PER_THREAD ? b->count : EVENTS_PER_THREAD;
+                uint64_t begin = b->count - n;                  // Oldest surviving event
+                for(uint64_t i = begin; i < b->count; i++){
+                    const Event& e = b->events[i % EVENTS_PER_THREAD];
+                    fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                            first ? "" : ",\n", e.name, b->tid, e.start / 1000.0, e.duration / 1000.0);
+                    first = false;
+                }
+            }
+            fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+            fclose(f);
+            return true;
+        }
+
+    private:
+        struct Buffer {
+            std::unique_ptr<Event[]> events{ new Event[EVENTS_PER_THREAD] };
+            uint64_t count = 0;
+            int tid = 0;
+        };
+
+        static std::atomic<bool>& enabledFlag(){ static std::atomic<bool> on{ false }; return on; }
+        static std::chrono::steady_clock::time_point epoch(){
+            static const auto t0 = std::chrono::steady_clock::now();
+            return t0;
+        }
+        static std::mutex& registryMutex(){ static std::mutex m; return m; }
+        static std::vector<std::unique_ptr<Buffer>>& registry(){
+            static std::vector<std::unique_ptr<Buffer>> buffers;
+            return buffers;
+        }
+
+        // Buffers are owned by the registry so spans survive thread exit
+        static Buffer& threadBuffer(){
+            thread_local Buffer* mine = nullptr;
+            if(!mine){
+                std::lock_guard<std::mutex> lock(registryMutex());
+                registry().emplace_back(new Buffer());
+                mine = registry().back().get();
+                mine->tid = (int)registry().size();
+            }
+            return *mine;
+        }
+};
+
+/// Records [construction, destruction) as one span when tracing is enabled
+class Chip8TraceScope {
+    public:
+        explicit Chip8TraceScope(const char* spanName){
+            if(Chip8Trace::enabled()){
+                name = spanName;
+                start = Chip8Trace::now();
+            }
+        }
+        ~Chip8TraceScope(){
+            if(name) Chip8Trace::record(name, start, Chip8Trace::now());
+        }
+
+        Chip8TraceScope(const Chip8TraceScope&) = delete;
+        Chip8TraceScope& operator=(const Chip8TraceScope&) = delete;
+
+    private:
+        const char* name = nullptr;
+        uint64_t start = 0;
+};
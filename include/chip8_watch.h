@@ -0,0 +1,180 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include "chip8.h"
+
+/// Registers an opcode reads and writes as masks: bit x for Vx, bit 16 for I.
+/// keys is the keypad mask it runs with: Fx0A writes Vx only when a key is
+/// down, and otherwise runs again without touching anything.
+inline void chip8RegisterAccess(unsigned op, uint16_t keys, uint32_t& reads, uint32_t& writes){
+    const uint32_t x = 1u << (op >> 8 & 15), y = 1u << (op >> 4 & 15);
+    const uint32_t upToX = (2u << (op >> 8 & 15)) - 1;     // V0..Vx
+    const uint32_t VF = 1u << 15, I = 1u << 16;
+    reads = writes = 0;
+    switch(op >> 12){
+        case 0x3: case 0x4: reads = x; break;
+        case 0x5: case 0x9: reads = x | y; break;
+        case 0x6: case 0xC: writes = x; break;
+        case 0x7: reads = writes = x; break;
+        case 0x8:
+            switch(op & 15){
+                case 0x0: reads = y; writes = x; break;
+                case 0x1: case 0x2: case 0x3: reads = x | y; writes = x; break;
+                case 0x4: case 0x5: case 0x7: reads = x | y; writes = x | VF; break;
+                case 0x6: case 0xE: reads = x; writes = x | VF; break;
+            }
+            break;
+        case 0xA: writes = I; break;
+        case 0xB: reads = 1; break;
+        case 0xD: reads = x | y | I; writes = VF; break;
+        case 0xE: if((op & 0xFF) == 0x9E || (op & 0xFF) == 0xA1) reads = x; break;
+        case 0xF:
+            switch(op & 0xFF){
+                case 0x07: writes = x; break;
+                case 0x0A: writes = keys ? x : 0; break;
+                case 0x15: case 0x18: reads = x; break;
+                case 0x1E: reads = x | I; writes = I; break;
+                case 0x29: reads = x; writes = I; break;
+                case 0x33: reads = x | I; break;
+                case 0x55: reads = upToX | I; break;
+                case 0x65: reads = I; writes = upToX; break;
+            }
+            break;
+    }
+}
+
+/// Execution breakpoints and read/write watchpoints on memory, V0-VF and I.
+/// Each kind is a bitmap indexed by address (or register number), and run()
+/// picks the cheapest hooks that cover what is set:
+///  - nothing set: the plain interpreter loop, the same code as Chip8::runCycles()
+///  - memory watches only: checked in the memory hooks, which only DXYN and
+///    Fx33/Fx55/Fx65 call; instructions that touch no memory pay one flag test
+///  - breakpoints: one bit test on the next pc per instruction
+///  - register watches: the opcode's register masks per instruction
+class Chip8Watch {
+    public:
+        enum Access : unsigned { READ = 1, WRITE = 2 };
+        static constexpr unsigned INDEX = 16;       // Register number of I for watchRegister()
+
+        enum Reason { NONE, BREAKPOINT, MEMORY_READ, MEMORY_WRITE, REGISTER_READ, REGISTER_WRITE };
+
+        /// Why run() stopped
+        struct Hit {
+            Reason reason = NONE;
+            uint16_t pc = 0, opcode = 0;            // The accessing instruction, or the breakpoint (next to run)
+            uint16_t where = 0;                     // Memory address, or register (0-15, INDEX)
+        };
+
+        void addBreakpoint(unsigned pc){
+            exec.set(pc & 0xFFF);
+            anyExec = true;
+        }
+        void removeBreakpoint(unsigned pc){
+            exec.reset(pc & 0xFFF);
+            anyExec = exec.any();
+        }
+        bool isBreakpoint(unsigned pc) const { return exec.test(pc & 0xFFF); }
+        size_t breakpointCount() const { return exec.count(); }
+
+        /// Watch a memory byte for READ, WRITE or both; 0 removes the watch
+        void watchMemory(unsigned addr, unsigned access = WRITE){
+            memRead.set(addr & 0xFFF, (access & READ) != 0);
+            memWrite.set(addr & 0xFFF, (access & WRITE) != 0);
+            anyMemRead = memRead.any();
+            anyMemWrite = memWrite.any();
+        }
+        unsigned memoryWatch(unsigned addr) const {
+            return (memRead.test(addr & 0xFFF) ? (unsigned)READ : 0u) | (memWrite.test(addr & 0xFFF) ? (unsigned)WRITE : 0u);
+        }
+
+        /// Watch Vx (0-15) or I (INDEX) for READ, WRITE or both; 0 removes the watch
+        void watchRegister(unsigned reg, unsigned access = WRITE){
+            uint32_t bit = 1u << (reg > INDEX ? INDEX : reg);
+            regRead = access & READ ? regRead | bit : regRead & ~bit;
+            regWrite = access & WRITE ? regWrite | bit : regWrite & ~bit;
+        }
+        unsigned registerWatch(unsigned reg) const {
+            uint32_t bit = 1u << (reg > INDEX ? INDEX : reg);
+            return (regRead & bit ? (unsigned)READ : 0u) | (regWrite & bit ? (unsigned)WRITE : 0u);
+        }
+
+        bool empty() const { return !anyExec && !anyMemRead && !anyMemWrite && !regRead && !regWrite; }
+
+        /// Run up to count instructions. Stops after an instruction that touched
+        /// a watched byte or register, or before one on a breakpoint (the first
+        /// instruction always runs). Returns the instructions run; hit() says why
+        /// it stopped early, or NONE.
+        unsigned long run(Chip8& emu, unsigned long count){
+            last = Hit();
+            if(!anyExec && !regRead && !regWrite){
+                if(!anyMemRead && !anyMemWrite){
+                    emu.runCycles(count);
+                    return count;
+                }
+                return runWith<false, false>(emu, count);
+            }
+            if(regRead || regWrite)
+                return anyExec ? runWith<true, true>(emu, count) : runWith<false, true>(emu, count);
+            return runWith<true, false>(emu, count);
+        }
+
+        const Hit& hit() const { return last; }
+
+    private:
+        std::bitset<4096> exec, memRead, memWrite;
+        bool anyExec = false, anyMemRead = false, anyMemWrite = false;     // Kept by the setters; run() never scans a map
+        uint32_t regRead = 0, regWrite = 0;         // Bits 0-15 V0-VF, bit 16 I
+        Hit last;
+
+        template<bool BREAKPOINTS, bool REGISTERS>
+        struct Hooks : Chip8NoHooks {
+            const Chip8Watch& watch;
+            const Chip8& emu;
+            Hit hit;
+            bool stop = false;
+
+            Hooks(const Chip8Watch& w, const Chip8& e) : watch(w), emu(e) {}
+
+            uint16_t opcodeAt(unsigned pc) const {
+                return (uint16_t)(emu.readMemory(pc) << 8 | emu.readMemory(pc + 1));
+            }
+            void record(Reason reason, unsigned pc, unsigned opcode, unsigned where){
+                if(stop) return;                    // Keep the first access of the instruction
+                hit.reason = reason;
+                hit.pc = (uint16_t)pc;
+                hit.opcode = (uint16_t)opcode;
+                hit.where = (uint16_t)where;
+                stop = true;
+            }
+            void onFetch(unsigned short pc, unsigned short op){
+                if(!REGISTERS) return;
+                uint32_t reads, writes;
+                chip8RegisterAccess(op, (op & 0xF0FF) == 0xF00A ? emu.getKeys() : 0, reads, writes);
+                if(uint32_t m = writes & watch.regWrite) record(REGISTER_WRITE, pc, op, chip8LowestBit(m));
+                else if(uint32_t m = reads & watch.regRead) record(REGISTER_READ, pc, op, chip8LowestBit(m));
+            }
+            void scan(const std::bitset<4096>& map, Reason reason, unsigned short pc, unsigned addr, unsigned count){
+                for(unsigned i = 0; i < count; i++)
+                    if(map.test((addr + i) & 0xFFF)) return record(reason, pc, opcodeAt(pc), (addr + i) & 0xFFF);
+            }
+            void onMemoryRead(unsigned short pc, unsigned addr, unsigned count){
+                if(watch.anyMemRead) scan(watch.memRead, MEMORY_READ, pc, addr, count);
+            }
+            void onMemoryWrite(unsigned short pc, unsigned addr, unsigned count){
+                if(watch.anyMemWrite) scan(watch.memWrite, MEMORY_WRITE, pc, addr, count);
+            }
+            bool stopAfter(unsigned short nextPc){
+                if(BREAKPOINTS && !stop && watch.exec.test(nextPc & 0xFFF)) record(BREAKPOINT, nextPc, opcodeAt(nextPc), nextPc);
+                return stop;
+            }
+        };
+
+        template<bool BREAKPOINTS, bool REGISTERS>
+        unsigned long runWith(Chip8& emu, unsigned long count){
+            Hooks<BREAKPOINTS, REGISTERS> hooks(*this, emu);
+            unsigned long ran = emu.runCycles(count, hooks);
+            last = hooks.hit;
+            return ran;
+        }
+};
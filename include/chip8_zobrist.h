@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include "chip8_state.h"
+
+/// Zobrist-style keys for the two large parts of the machine state. A part's
+/// hash is the XOR of the keys of its non-zero cells (memory byte, lit pixel),
+/// so one write updates it with two XORs and a cleared part hashes to 0.
+/// Memory keys are mixed from (address, value) on the fly; pixel keys come
+/// from a table because DXYN toggles many per draw. The small fields
+/// (registers, stack, timers, RNG) are hashed when the hash is read: PC and
+/// the timers change on nearly every instruction, so tracking them
+/// incrementally would cost more than hashing 200 bytes on demand.
+
+/// splitmix64 finalizer
+constexpr uint64_t chip8ZobristMix(uint64_t x){
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+inline uint64_t chip8ZobristByte(unsigned addr, unsigned char value){
+    return value ? chip8ZobristMix((uint64_t)addr << 8 | value) : 0;
+}
+
+struct Chip8ZobristPixels {
+    uint64_t key[2048];
+    constexpr Chip8ZobristPixels() : key() {
+        for(unsigned i = 0; i < 2048; i++) key[i] = chip8ZobristMix(2ull << 40 | i);
+    }
+};
+
+inline constexpr Chip8ZobristPixels CHIP8_ZOBRIST_PIXELS{};
+
+/// From scratch: memory
+inline uint64_t chip8ZobristMemory(const uint8_t* memory){
+    uint64_t h = 0;
+    for(unsigned a = 0; a < 4096; a++) h ^= chip8ZobristByte(a, memory[a]);
+    return h;
+}
+
+/// From scratch: framebuffer
+inline uint64_t chip8ZobristGfx(const uint8_t* gfx){
+    uint64_t h = 0;
+    for(unsigned i = 0; i < 2048; i++) if(gfx[i]) h ^= CHIP8_ZOBRIST_PIXELS.key[i];
+    return h;
+}
+
+/// Whole-state hash: the two Zobrist parts plus the small fields, hashed at read time.
+/// Covers exactly what Chip8::matchesState compares (not opcode or drawFlag).
+inline uint64_t chip8StateHash(uint64_t zobristMemory, uint64_t zobristGfx, const uint8_t* reg, const uint8_t* key,
+                               const uint16_t* stack, uint16_t I, uint16_t pc, uint8_t sp,
+                               uint8_t delayTimer, uint8_t soundTimer, const uint8_t* rng){
+    uint64_t buf[26];                                       // 16 + 16 + 32 + 8 + 136 bytes
+    unsigned char* p = reinterpret_cast<unsigned char*>(buf);
+    memcpy(p, reg, 16);
+    memcpy(p + 16, key, 16);
+    memcpy(p + 32, stack, 32);
+    buf[8] = (uint64_t)I | (uint64_t)pc << 16 | (uint64_t)sp << 32 | (uint64_t)delayTimer << 40 | (uint64_t)soundTimer << 48;
+    memcpy(p + 72, rng, 136);
+    return chip8Hash(buf, sizeof(buf)) ^ zobristMemory ^ chip8ZobristMix(zobristGfx);
+}
+
+/// Hash of a snapshot, recomputed from its contents
+inline uint64_t chip8StateHash(const Chip8State& s){
+    return chip8StateHash(chip8ZobristMemory(s.memory), chip8ZobristGfx(s.gfx), s.reg, s.key, s.stack,
+                          s.I, s.pc, s.sp, s.delayTimer, s.soundTimer, s.rng);
+}
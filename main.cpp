@@ -1,28 +1,86 @@
 //Project inspired from: https://multigesture.net/articles/how-to-write-an-emulator-chip-8-interpreter/
 
+#include <cstring>
 #include <iostream>
 #include <SDL2/SDL.h>
 #include "chip8.h"
+#include "chip8_movie.h"
+#include "chip8_rewind.h"
+#include "chip8_trace.h"
 using namespace std;
 
 
 static void renderChip8(SDL_Renderer* renderer, SDL_Texture* texture, const unsigned char* gfx) {
     static unsigned int pixels[64 * 32];
 
-    for (int i = 0; i < 64 * 32; i++) {
-        pixels[i] = gfx[i] ? 0xFFFFFFFF : 0x000000FF;
+    {
+        Chip8TraceScope span("convert_pixels");
+        for (int i = 0; i < 64 * 32; i++) {
+            pixels[i] = gfx[i] ? 0xFFFFFFFF : 0x000000FF;
+        }
+    }
+
+    {
+        Chip8TraceScope span("SDL_UpdateTexture");
+        SDL_UpdateTexture(texture, nullptr, pixels, 64 * sizeof(unsigned int));
+    }
+
+    {
+        Chip8TraceScope span("SDL_RenderCopy");
+        SDL_RenderClear(renderer);
+        SDL_RenderCopy(renderer, texture, nullptr, nullptr);
     }
 
-    SDL_UpdateTexture(texture, nullptr, pixels, 64 * sizeof(unsigned int));
-    SDL_RenderClear(renderer);
-    SDL_RenderCopy(renderer, texture, nullptr, nullptr);
-    SDL_RenderPresent(renderer);
+    {
+        Chip8TraceScope span("SDL_RenderPresent");
+        SDL_RenderPresent(renderer);
+    }
 }
 
 
 
-int main()
+// Keypad mapping from the Controls table in the readme
+static unsigned short readKeypad() {
+    static const SDL_Scancode layout[16] = {
+        SDL_SCANCODE_X, SDL_SCANCODE_1, SDL_SCANCODE_2, SDL_SCANCODE_3,     // 0 1 2 3
+        SDL_SCANCODE_Q, SDL_SCANCODE_W, SDL_SCANCODE_E, SDL_SCANCODE_A,     // 4 5 6 7
+        SDL_SCANCODE_S, SDL_SCANCODE_D, SDL_SCANCODE_Z, SDL_SCANCODE_C,     // 8 9 A B
+        SDL_SCANCODE_4, SDL_SCANCODE_R, SDL_SCANCODE_F, SDL_SCANCODE_V      // C D E F
+    };
+    const Uint8* state = SDL_GetKeyboardState(nullptr);
+    unsigned short mask = 0;
+    for (int i = 0; i < 16; i++) {
+        if (state[layout[i]]) mask |= 1 << i;
+    }
+    return mask;
+}
+
+
+int main(int argc, char** argv)
 {
+    const char* romPath = "roms/Sierpinski.ch8";
+    const char* tracePath = nullptr;            // Chrome trace output; F12 also saves it
+    const char* recordPath = nullptr;           // Input movie to write on exit
+    const char* playPath = nullptr;             // Input movie to replay
+    int runAhead = 0;                           // Frames emulated ahead of the presented one
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--trace") && i + 1 < argc) tracePath = argv[++i];
+        else if (!strcmp(argv[i], "--record") && i + 1 < argc) recordPath = argv[++i];
+        else if (!strcmp(argv[i], "--play") && i + 1 < argc) playPath = argv[++i];
+        else if (!strcmp(argv[i], "--runahead") && i + 1 < argc) runAhead = atoi(argv[++i]);
+        else romPath = argv[i];
+    }
+    if (tracePath) Chip8Trace::enable(true);
+
+    Chip8Movie movie;
+    movie.seed = (uint64_t)time(nullptr);
+    if (playPath && !movie.load(playPath)) {
+        cerr << "Failed to read movie " << playPath << "\n";
+        return -6;
+    }
+    Chip8MovieSession session(movie, playPath ? Chip8MovieSession::PLAY : Chip8MovieSession::RECORD);
+
     Chip8 emulator = Chip8();
 
     /*
@@ -65,9 +123,9 @@ int main()
         return -4;
     }
 
-    emulator.init();
+    emulator.init(movie.seed, movie.rng);
 
-    if (!emulator.loadROM("roms/Sierpinski.ch8")) {
+    if (!emulator.loadROM(romPath) || !session.start(emulator)) {
         std::cerr << "Failed to load ROM\n";
         SDL_DestroyTexture(texture);
         SDL_DestroyRenderer(renderer);
@@ -76,21 +134,153 @@ int main()
         return -5;
     }
 
+    // Rewind history while Backspace is held (16 MB is well over an hour for most ROMs).
+    // Disabled for movies, which must stay a straight line of frames.
+    const bool canRewind = !recordPath && !playPath;
+    Chip8Rewind rewind(16u << 20);
+    static Chip8State snapshot;
+
+    // Run-ahead: after each real frame, emulate runAhead frames with the same
+    // input, present that future picture, then restore the real state.
+    const int maxRunAhead = 8;
+    if (runAhead < 0) runAhead = 0;
+    if (runAhead > maxRunAhead) runAhead = maxRunAhead;
+    static Chip8State aheadState;
+    static unsigned char shown[64 * 32];        // Picture presented this frame
+
+    // Input latency: on a key press, emulate the next frames with the old input
+    // as a reference; the first presented picture that differs from it is where
+    // the press became visible.
+    const int latencyWindow = 30;
+    unsigned long long reference[latencyWindow + maxRunAhead + 1];
+    bool latencyPending = false;
+    int framesSincePress = 0;
+    Uint64 pressTick = 0;
+    unsigned short lastKeys = 0;
+    double latencyMs = 0;                       // Average over presses
+
+    // Stats in the window title, refreshed every second
+    Uint64 emulateTicks = 0;
+    Uint64 statsStart = SDL_GetPerformanceCounter();
+
+    // One iteration per 60 Hz frame: a batch of CPU cycles, then present
+    const Uint64 frameTicks = SDL_GetPerformanceFrequency() / 60;
+    Uint64 nextFrame = SDL_GetPerformanceCounter() + frameTicks;
+
     bool running = true;
     while (running) {
-        SDL_Event e;
-        while (SDL_PollEvent(&e)) {
-            if (e.type == SDL_QUIT) running = false;
+        Chip8TraceScope frameSpan("frame");
+
+        {
+            Chip8TraceScope span("poll_events");
+            SDL_Event e;
+            while (SDL_PollEvent(&e)) {
+                if (e.type == SDL_QUIT) running = false;
+                if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F12 && tracePath) {
+                    if (Chip8Trace::writeJson(tracePath)) cout << "Trace written to " << tracePath << endl;
+                }
+            }
+        }
+
+        unsigned short keys = readKeypad();
+        Uint64 emulateStart = SDL_GetPerformanceCounter();
+        if ((keys & ~lastKeys) && !playPath) {
+            // Speculative frames: quiet (no BEEP), and the snapshot is only ever loaded back here
+            Chip8TraceScope span("latency_reference");
+            emulator.saveState(aheadState, false);
+            emulator.setKeys(lastKeys);
+            emulator.setVerbose(false);
+            for (int i = 0; i <= latencyWindow + runAhead; i++) {
+                emulator.runCycles(Chip8::CYCLES_PER_FRAME);
+                reference[i] = chip8Hash(emulator.getGfx(), sizeof(shown));
+            }
+            emulator.setVerbose(true);
+            emulator.loadState(aheadState, false);
+            latencyPending = true;
+            framesSincePress = 0;
+            pressTick = SDL_GetPerformanceCounter();
+        }
+        lastKeys = keys;
+
+        bool rewinding = canRewind && SDL_GetKeyboardState(nullptr)[SDL_SCANCODE_BACKSPACE];
+        if (rewinding) {
+            Chip8TraceScope span("rewind");
+            const Chip8State* previous = rewind.stepBack();
+            if (previous) emulator.loadState(*previous, false);
+        }
+        else {
+            {
+                Chip8TraceScope span("emulate");
+                session.frame(emulator, keys);
+            }
+            if (playPath && session.done()) running = false;
+            if (canRewind) {
+                Chip8TraceScope span("snapshot");
+                emulator.saveState(snapshot);
+                rewind.push(snapshot);
+            }
         }
 
-        emulator.nextCycle();
+        bool present = emulator.shouldDraw() || rewinding || runAhead > 0;
+        if (runAhead > 0 && !rewinding) {
+            Chip8TraceScope span("run_ahead");
+            emulator.saveState(aheadState, false);
+            emulator.setVerbose(false);
+            emulator.runCycles((unsigned long)runAhead * Chip8::CYCLES_PER_FRAME);
+            emulator.setVerbose(true);
+            memcpy(shown, emulator.getGfx(), sizeof(shown));
+            emulator.loadState(aheadState, false);
+        }
+        else if (present) {
+            memcpy(shown, emulator.getGfx(), sizeof(shown));
+        }
+        emulateTicks += SDL_GetPerformanceCounter() - emulateStart;
 
-        if(emulator.shouldDraw()){
-            renderChip8(renderer, texture, emulator.getGfx());
+        if(present){
+            Chip8TraceScope span("render");
+            renderChip8(renderer, texture, shown);
             emulator.clearDrawFlag();
         }
 
-        SDL_Delay(0);
+        if (latencyPending) {
+            if (chip8Hash(shown, sizeof(shown)) != reference[framesSincePress + runAhead]) {
+                double ms = (SDL_GetPerformanceCounter() - pressTick) * 1000.0 / SDL_GetPerformanceFrequency();
+                latencyMs = latencyMs ? latencyMs * 0.8 + ms * 0.2 : ms;
+                latencyPending = false;
+            }
+            else if (++framesSincePress > latencyWindow) {
+                latencyPending = false;                 // The press changed nothing on screen
+            }
+        }
+
+        Uint64 statsNow = SDL_GetPerformanceCounter();
+        if (statsNow - statsStart >= SDL_GetPerformanceFrequency()) {
+            char title[128];
+            snprintf(title, sizeof(title), "Chip8 Emulator | run-ahead %d | input latency %.1f ms | core %.2f%%",
+                     runAhead, latencyMs, 100.0 * emulateTicks / (statsNow - statsStart));
+            SDL_SetWindowTitle(window, title);
+            emulateTicks = 0;
+            statsStart = statsNow;
+        }
+
+        {
+            Chip8TraceScope span("wait");
+            Uint64 now = SDL_GetPerformanceCounter();
+            if (now < nextFrame) SDL_Delay((Uint32)((nextFrame - now) * 1000 / SDL_GetPerformanceFrequency()));
+            nextFrame = (now > nextFrame + frameTicks) ? now + frameTicks : nextFrame + frameTicks;
+        }
+    }
+
+    if (recordPath) {
+        session.finish();
+        if (!movie.save(recordPath)) cerr << "Failed to write movie " << recordPath << "\n";
+    }
+    if (playPath && session.done()) {
+        cout << (session.finish() ? "Replay matched the recording" : "Replay DIVERGED from the recording") << endl;
+    }
+
+    if (tracePath && !Chip8Trace::writeJson(tracePath)) {
+        cerr << "Failed to write trace " << tracePath << "\n";
     }
 
     SDL_DestroyTexture(texture);
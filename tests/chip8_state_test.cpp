@@ -0,0 +1,230 @@
+// Save/restore round trips: in memory, through a sealed blob, and through the
+// mmap'd Chip8StateFile. Exits nonzero if any check fails (run by ctest).
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "chip8.h"
+#include "chip8_state.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if(!(cond)){ fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); failures++; } \
+} while(0)
+
+/// A program that touches every part of the state: registers, I, the stack,
+/// timers, the generator, memory (Fx33/Fx55) and the framebuffer (DXYN)
+static std::vector<unsigned char> busyProgram(){
+    const unsigned short ops[] = {
+        0x6A05, 0x6B0A, 0xF015, 0xF018,     // 200: VA, VB, delay and sound timers
+        0x2220,                             // 208: CALL 220
+        0x7A01, 0xCB7F, 0xA300, 0xFB33,     // 20A: VA++, VB = rnd, I = 300, BCD VB
+        0xFB55, 0xDAB5, 0x8AB4, 0x1208,     // 212: store V0-VB, draw, ADD, loop to 208
+        0x0000, 0x0000,                     // 21A: padding
+        0x0000,
+        0x8AB5, 0xF01E, 0x00EE,             // 220: SUB, ADD I, RET
+    };
+    std::vector<unsigned char> rom;
+    for(unsigned short op : ops){
+        rom.push_back((unsigned char)(op >> 8));
+        rom.push_back((unsigned char)op);
+    }
+    return rom;
+}
+
+static void machine(Chip8& emu){
+    std::vector<unsigned char> rom = busyProgram();
+    emu.init(7);
+    emu.loadProgram(rom.data(), (int)rom.size());
+    emu.runCycles(500);
+}
+
+/// save -> run -> load -> run reproduces the same machine
+static void testRoundTrip(){
+    static Chip8State a, b, c;
+    Chip8 emu(false);
+    machine(emu);
+    emu.saveState(a);
+    CHECK(a.valid());
+    CHECK(emu.matchesState(a));
+    uint64_t hashA = emu.stateHash();
+
+    emu.runCycles(1000);
+    emu.saveState(b);
+    CHECK(!emu.matchesState(a));
+
+    CHECK(emu.loadState(a));
+    CHECK(emu.matchesState(a));
+    CHECK(emu.stateHash() == hashA);
+    emu.runCycles(1000);
+    emu.saveState(c);
+    CHECK(emu.matchesState(b));
+    CHECK(memcmp(&b, &c, sizeof(b)) == 0);
+
+    Chip8 other(false);                             // A fresh instance restores the same machine
+    other.init(99);
+    CHECK(other.loadState(a));
+    CHECK(other.matchesState(a));
+    CHECK(other.stateHash() == hashA);
+}
+
+/// Damaged or foreign blobs are rejected and leave the machine as it was
+static void testRejects(){
+    static Chip8State a, bad, before;
+    Chip8 emu(false);
+    machine(emu);
+    emu.saveState(a);
+    emu.runCycles(100);
+    emu.saveState(before);
+
+    bad = a;
+    bad.memory[0x300] ^= 1;                         // Payload no longer matches the checksum
+    CHECK(!bad.valid());
+    CHECK(!emu.loadState(bad));
+    CHECK(emu.matchesState(before));
+
+    bad = a;
+    bad.checksum ^= 1ull << 17;                     // Corrupted checksum
+    CHECK(!bad.valid());
+    CHECK(!emu.loadState(bad));
+
+    bad = a;
+    bad.version = Chip8State::VERSION - 1;          // Payload intact, older layout
+    CHECK(!emu.loadState(bad));
+    bad.version = Chip8State::VERSION + 1;
+    CHECK(!emu.loadState(bad));
+
+    bad = a;
+    bad.magic ^= 1;
+    CHECK(!emu.loadState(bad));
+
+    bad = a;
+    bad.size = sizeof(Chip8State) - 32;
+    CHECK(!emu.loadState(bad));
+
+    CHECK(emu.matchesState(before));
+    CHECK(emu.loadState(a));                        // The original still loads
+    CHECK(emu.matchesState(a));
+}
+
+static bool writeBytes(const std::string& path, const void* data, size_t size){
+    FILE* f = fopen(path.c_str(), "wb");
+    if(!f) return false;
+    bool ok = fwrite(data, 1, size, f) == size;
+    return fclose(f) == 0 && ok;
+}
+
+/// writeChip8State -> Chip8StateFile (mmap'd) -> loadState
+static void testFile(){
+    static Chip8State a, bad;
+    std::string path = (std::filesystem::temp_directory_path() / "chip8_state_test.c8s").string();
+    Chip8 emu(false);
+    machine(emu);
+    emu.saveState(a);
+    CHECK(writeChip8State(path.c_str(), a));
+    {
+        Chip8StateFile file(path.c_str());
+        CHECK(file.state() != nullptr);
+        if(file.state()){
+            CHECK(memcmp(file.state(), &a, sizeof(a)) == 0);
+            Chip8 other(false);
+            other.init(1);
+            CHECK(other.loadState(*file.state()));
+            CHECK(other.matchesState(a));
+            CHECK(other.stateHash() == emu.stateHash());
+        }
+    }
+
+    bad = a;
+    bad.gfx[100] ^= 1;                              // Corrupted on disk
+    CHECK(writeBytes(path, &bad, sizeof(bad)));
+    {
+        Chip8StateFile file(path.c_str());
+        CHECK(file.state() == nullptr);
+    }
+
+    bad = a;
+    bad.version = Chip8State::VERSION + 1;          // Written by another build
+    CHECK(writeBytes(path, &bad, sizeof(bad)));
+    {
+        Chip8StateFile file(path.c_str());
+        CHECK(file.state() == nullptr);
+    }
+
+    CHECK(writeBytes(path, &a, sizeof(a) - 1));     // Truncated
+    {
+        Chip8StateFile file(path.c_str());
+        CHECK(file.state() == nullptr);
+    }
+
+    std::filesystem::remove(path);
+    {
+        Chip8StateFile file(path.c_str());          // Missing
+        CHECK(file.state() == nullptr);
+    }
+}
+
+/// share() and unpark() read the base in place until the first store,
+/// which copies it; the base itself never changes
+static void testShare(){
+    static Chip8State base, baseCopy, expected;
+    Chip8 emu(false);
+    std::vector<unsigned char> rom = busyProgram();
+    emu.init(7);
+    emu.loadProgram(rom.data(), (int)rom.size());
+    emu.checkpoint(base);
+    baseCopy = base;
+    emu.runCycles(2000);
+    emu.saveState(expected, false);
+
+    Chip8 shared(false);
+    shared.share(base);
+    CHECK(shared.matchesState(base));
+    CHECK(shared.residentBytes() == sizeof(Chip8));  // No memory of its own yet
+    shared.runCycles(4);                            // Up to the first Fx33
+    CHECK(shared.residentBytes() == sizeof(Chip8));
+    shared.runCycles(1996);
+    CHECK(shared.residentBytes() > sizeof(Chip8));
+    CHECK(shared.matchesState(expected));
+    CHECK(shared.stateHash() == emu.stateHash());
+    CHECK(memcmp(&base, &baseCopy, sizeof(base)) == 0);
+
+    Chip8 copy = shared;                            // Copies of a private instance are private
+    copy.runCycles(100);
+    CHECK(shared.matchesState(expected));
+
+    shared.resetTo(base);
+    CHECK(shared.matchesState(base));
+
+    Chip8Parked parked;
+    shared.park(parked, base);
+    CHECK(parked.memoryPages == 0);
+    Chip8 other(false);
+    other.init(3);
+    other.unpark(parked);                           // Nothing stored: runs on the base in place
+    CHECK(other.matchesState(base));
+    other.runCycles(2000);
+    CHECK(other.matchesState(expected));
+    other.park(parked, base);
+    CHECK(parked.memoryPages != 0);
+    other.unpark(parked);
+    CHECK(other.matchesState(expected));
+    CHECK(other.stateHash() == emu.stateHash());
+    CHECK(memcmp(&base, &baseCopy, sizeof(base)) == 0);
+}
+
+int main(){
+    testRoundTrip();
+    testRejects();
+    testFile();
+    testShare();
+    if(failures){
+        fprintf(stderr, "chip8_state_test: %d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("chip8_state_test: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,1089 @@
+// Headless benchmark for the Chip8 core.
+// Runs synthetic opcode-mix ROMs plus roms/Pong.ch8 with scripted input and
+// prints the results as JSON on stdout. Hardware counters (Linux perf) are
+// reported per emulated instruction when the kernel allows it.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "chip8.h"
+#include "chip8_batch.h"
+#include "chip8_coverage.h"
+#include "chip8_env.h"
+#include "chip8_execlog.h"
+#include "chip8_flame.h"
+#include "chip8_hang.h"
+#include "chip8_rewind.h"
+#include "chip8_watch.h"
+#include "perf_counters.h"
+
+#ifndef CHIP8_ROM_DIR
+#define CHIP8_ROM_DIR "roms"
+#endif
+
+using namespace std;
+
+// Assembles a program starting at 0x200
+struct RomBuilder {
+    vector<unsigned char> bytes;
+
+    unsigned short here() const { return 0x200 + (unsigned short)bytes.size(); }
+
+    void op(unsigned short o){
+        bytes.push_back(o >> 8);
+        bytes.push_back(o & 0xFF);
+    }
+};
+
+struct Workload {
+    string name;
+    vector<unsigned char> rom;
+    bool scriptedInput;                 // Drive the keypad frame by frame (Pong)
+};
+
+static vector<unsigned char> aluRom(){
+    RomBuilder r;
+    for(int i = 0; i < 8; i++) r.op(0x6000 | (i << 8) | (i * 17 + 3));
+    unsigned short loop = r.here();
+    r.op(0x8014); r.op(0x8125); r.op(0x8236); r.op(0x8307);
+    r.op(0x840E); r.op(0x8501); r.op(0x8612); r.op(0x8723);
+    r.op(0x7001); r.op(0x7105); r.op(0x8450); r.op(0x8561);
+    r.op(0x1000 | loop);
+    return r.bytes;
+}
+
+static vector<unsigned char> branchRom(){
+    RomBuilder r;
+    r.op(0x6000); r.op(0x6107); r.op(0x6303);
+    unsigned short loop = r.here();
+    r.op(0x7001);                                   // V0++
+    r.op(0x8200); r.op(0x8232);                     // V2 = V0 & 3
+    // Every skip is followed by a jump to the instruction after it, so both
+    // paths converge while the outcome still depends on the data.
+    const unsigned short skips[] = { 0x3200, 0x4201, 0x5210, 0x9230, 0x3202, 0x4003 };
+    for(unsigned short s : skips){
+        r.op(s);
+        r.op(0x1000 | (r.here() + 4));
+        r.op(0x7401);
+    }
+    r.op(0x1000 | loop);
+    return r.bytes;
+}
+
+static vector<unsigned char> drawRom(){
+    RomBuilder r;
+    r.op(0x00E0); r.op(0x6000); r.op(0x6100); r.op(0x6207);
+    unsigned short loop = r.here();
+    r.op(0xA050); r.op(0xD015);                     // Glyph 0
+    r.op(0xF229); r.op(0xD105);                     // Glyph V2
+    r.op(0x7005); r.op(0x7103); r.op(0x7201);
+    r.op(0xA064); r.op(0xD01A);                     // Two glyphs as one tall sprite
+    r.op(0x1000 | loop);
+    return r.bytes;
+}
+
+static vector<unsigned char> memoryRom(){
+    RomBuilder r;
+    r.op(0x6000);
+    unsigned short loop = r.here();
+    r.op(0xA300); r.op(0xF033);                     // BCD of V0
+    r.op(0xA310); r.op(0xFF55);                     // Store V0-VF
+    r.op(0xA310); r.op(0xFE65);                     // Load V0-VE
+    r.op(0xA320); r.op(0xF71E); r.op(0xF755);       // I += V7, store V0-V7
+    r.op(0x7001);
+    r.op(0x1000 | loop);
+    return r.bytes;
+}
+
+static vector<unsigned char> callRom(){
+    RomBuilder r;
+    // 0x200: main loop, subroutines follow at fixed addresses
+    const unsigned short s1 = 0x220, s2 = 0x230, s3 = 0x240;
+    r.op(0x2000 | s1); r.op(0x2000 | s1); r.op(0x1200);
+    while(r.here() < s1) r.op(0x0000);
+    r.op(0x7001); r.op(0x2000 | s2); r.op(0x2000 | s2); r.op(0x00EE);
+    while(r.here() < s2) r.op(0x0000);
+    r.op(0x7101); r.op(0x2000 | s3); r.op(0x00EE);
+    while(r.here() < s3) r.op(0x0000);
+    r.op(0x7201); r.op(0x00EE);
+    return r.bytes;
+}
+
+static vector<unsigned char> randomRom(){
+    RomBuilder r;
+    unsigned short loop = r.here();
+    for(int i = 0; i < 8; i++) r.op(0xC0FF | (i << 8));     // Cxkk into V0-V7
+    r.op(0x8014); r.op(0x8125);
+    r.op(0x1000 | loop);
+    return r.bytes;
+}
+
+static bool readFile(const string& path, vector<unsigned char>& out){
+    FILE* f = fopen(path.c_str(), "rb");
+    if(!f) return false;
+    unsigned char buf[4096];
+    size_t n;
+    while((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+    fclose(f);
+    return !out.empty();
+}
+
+// Pong: player 1 holds 1 (up) then 4 (down), player 2 mirrors with C/D
+static unsigned short pongKeys(unsigned long frame){
+    bool up = (frame / 40) % 2 == 0;
+    return up ? (1 << 0x1 | 1 << 0xD) : (1 << 0x4 | 1 << 0xC);
+}
+
+static void pongInput(Chip8& emu, unsigned long frame){
+    emu.setKeys(pongKeys(frame));
+}
+
+struct Stat {
+    double mean = 0, ci95 = 0;
+};
+
+// Mean and 95% confidence half-width (Student's t)
+static Stat summarize(const vector<double>& v){
+    static const double t95[] = {
+        0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    Stat s;
+    size_t n = v.size();
+    if(n == 0) return s;
+    for(double x : v) s.mean += x;
+    s.mean /= n;
+    if(n < 2) return s;
+    double var = 0;
+    for(double x : v) var += (x - s.mean) * (x - s.mean);
+    var /= (n - 1);
+    double t = (n - 1 <= 30) ? t95[n - 1] : 1.960;
+    s.ci95 = t * sqrt(var / n);
+    return s;
+}
+
+// Correctness checks printed in the JSON; main() exits nonzero if any failed
+static vector<string> failedChecks;
+
+static const char* check(const char* name, bool ok){
+    if(!ok) failedChecks.push_back(name);
+    return ok ? "true" : "false";
+}
+
+static void printStat(const char* key, const Stat& s, bool last){
+    printf("      \"%s\": { \"mean\": %.4f, \"ci95\": %.4f }%s\n", key, s.mean, s.ci95, last ? "" : ",");
+}
+
+// Counter values per emulated instruction; null when the counter is unavailable.
+// counted_percent is the share of each sample the counter group was on the
+// PMU; below 100 the values are scaled estimates.
+static void printPerf(const PerfCounters& pc, const vector<double>* perInstr, const vector<double>& ipc,
+                      const vector<double>& counted){
+    printf("      \"perf_per_instruction\": {\n");
+    for(int c = 0; c < PerfCounters::COUNT; c++){
+        if(!pc.available(c)){
+            printf("        \"%s\": null,\n", PerfCounters::name(c));
+            continue;
+        }
+        Stat s = summarize(perInstr[c]);
+        printf("        \"%s\": { \"mean\": %.4f, \"ci95\": %.4f },\n", PerfCounters::name(c), s.mean, s.ci95);
+    }
+    if(pc.available(PerfCounters::CYCLES) && pc.available(PerfCounters::INSTRUCTIONS)){
+        Stat s = summarize(ipc);
+        printf("        \"ipc\": { \"mean\": %.4f, \"ci95\": %.4f },\n", s.mean, s.ci95);
+    }
+    else printf("        \"ipc\": null,\n");
+    if(counted.empty()) printf("        \"counted_percent\": null\n");
+    else{
+        Stat s = summarize(counted);
+        printf("        \"counted_percent\": { \"mean\": %.2f, \"ci95\": %.2f }\n", s.mean, s.ci95);
+    }
+    printf("      },\n");
+}
+
+// Save/restore must reproduce the machine exactly, in memory and via a file
+static bool stateRoundTrip(Chip8& emu){
+    static Chip8State a, b, c;
+    emu.saveState(a);
+    emu.runCycles(1000);
+    emu.saveState(b);
+    if(!emu.loadState(a)) return false;
+    emu.runCycles(1000);
+    emu.saveState(c);
+    if(memcmp(&b, &c, sizeof(b)) != 0) return false;
+
+    c = a;
+    c.memory[0x300] ^= 1;                           // Corrupted blobs are rejected
+    if(emu.loadState(c)) return false;
+
+    const char* path = "chip8_bench_state.tmp";
+    if(!writeChip8State(path, a)) return false;
+    bool same;
+    {
+        Chip8StateFile file(path);
+        same = file.state() && memcmp(file.state(), &a, sizeof(a)) == 0 && emu.loadState(*file.state());
+    }
+    remove(path);
+    return same;
+}
+
+static void benchSaveState(Chip8& emu, int samples){
+    const int reps = 20000;
+    static Chip8State s;
+    vector<double> saveNs, restoreNs, restoreFastNs;
+    bool roundTrip = stateRoundTrip(emu);
+
+    for(int i = 0; i < samples; i++){
+        auto t0 = chrono::steady_clock::now();
+        for(int r = 0; r < reps; r++) emu.saveState(s);
+        auto t1 = chrono::steady_clock::now();
+        for(int r = 0; r < reps; r++) emu.loadState(s);
+        auto t2 = chrono::steady_clock::now();
+        for(int r = 0; r < reps; r++) emu.loadState(s, false);
+        auto t3 = chrono::steady_clock::now();
+        saveNs.push_back(chrono::duration<double, nano>(t1 - t0).count() / reps);
+        restoreNs.push_back(chrono::duration<double, nano>(t2 - t1).count() / reps);
+        restoreFastNs.push_back(chrono::duration<double, nano>(t3 - t2).count() / reps);
+    }
+
+    printf("  \"savestate\": {\n");
+    printf("      \"bytes\": %zu,\n", sizeof(Chip8State));
+    printf("      \"version\": %u,\n", (unsigned)Chip8State::VERSION);
+    printf("      \"round_trip\": %s,\n", check("savestate.round_trip", roundTrip));
+    printStat("save_ns", summarize(saveNs), false);
+    printStat("restore_ns", summarize(restoreNs), false);
+    printStat("restore_unverified_ns", summarize(restoreFastNs), true);
+    printf("  },\n");
+}
+
+// State hash: the incremental O(1) read against hashing a snapshot from scratch
+static void benchStateHash(Chip8& emu, int samples){
+    const int reps = 20000;
+    static Chip8State s;
+    emu.saveState(s);
+    bool agrees = emu.stateHash() == chip8StateHash(s);
+    vector<double> incrementalNs, scratchNs;
+    volatile uint64_t sink = 0;
+
+    for(int i = 0; i < samples; i++){
+        auto t0 = chrono::steady_clock::now();
+        for(int r = 0; r < reps; r++) sink = sink + emu.stateHash();
+        auto t1 = chrono::steady_clock::now();
+        for(int r = 0; r < reps / 10; r++) sink = sink + chip8StateHash(s);
+        auto t2 = chrono::steady_clock::now();
+        incrementalNs.push_back(chrono::duration<double, nano>(t1 - t0).count() / reps);
+        scratchNs.push_back(chrono::duration<double, nano>(t2 - t1).count() / (reps / 10));
+    }
+
+    printf("  \"state_hash\": {\n");
+    printf("      \"matches_recompute\": %s,\n", check("state_hash.matches_recompute", agrees));
+    printStat("incremental_read_ns", summarize(incrementalNs), false);
+    printStat("from_scratch_ns", summarize(scratchNs), true);
+    printf("  },\n");
+}
+
+// Pong with one snapshot per frame: retained bytes and the cost of going back
+static void benchRewind(const vector<unsigned char>& rom, unsigned long frames){
+    const unsigned cpf = Chip8::CYCLES_PER_FRAME;
+    Chip8Rewind rewind(64u << 20);
+    static Chip8State s;
+    Chip8 emu(false);
+    emu.init();
+    emu.loadProgram(rom.data(), (int)rom.size());
+
+    double frameNs = 0, pushNs = 0;
+    for(unsigned long f = 0; f < frames; f++){
+        auto t0 = chrono::steady_clock::now();
+        pongInput(emu, f);
+        emu.runCycles(cpf);
+        auto t1 = chrono::steady_clock::now();
+        emu.saveState(s);
+        rewind.push(s);
+        auto t2 = chrono::steady_clock::now();
+        frameNs += chrono::duration<double, nano>(t1 - t0).count();
+        pushNs += chrono::duration<double, nano>(t2 - t1).count();
+    }
+
+    // Step back over half the history, restoring each frame into the core
+    size_t steps = rewind.frames() / 2;
+    size_t retained = rewind.frames();
+    double bytesPerSecond = rewind.bytesPerSecond();
+    size_t used = rewind.bytesUsed();
+    auto t0 = chrono::steady_clock::now();
+    for(size_t i = 0; i < steps; i++){
+        const Chip8State* prev = rewind.stepBack();
+        if(prev) emu.loadState(*prev, false);
+    }
+    auto t1 = chrono::steady_clock::now();
+
+    printf("  \"rewind\": {\n");
+    printf("      \"frames\": %zu,\n", retained);
+    printf("      \"ring_bytes\": %zu,\n", used);
+    printf("      \"bytes_per_second\": %.1f,\n", bytesPerSecond);
+    printf("      \"frame_ns\": %.1f,\n", frameNs / frames);
+    printf("      \"save_push_ns\": %.1f,\n", pushNs / frames);
+    printf("      \"step_back_ns\": %.1f\n", steps ? chrono::duration<double, nano>(t1 - t0).count() / steps : 0.0);
+    printf("  },\n");
+}
+
+// Host cost of one presented frame with N frames of run-ahead: the real frame,
+// then save, N speculative frames and restore. Reported as a share of one core
+// at 60 fps.
+static void benchRunAhead(const vector<unsigned char>& rom, unsigned long frames){
+    const unsigned cpf = Chip8::CYCLES_PER_FRAME;
+    static Chip8State s;
+    printf("  \"runahead\": [\n");
+    for(int ahead = 0; ahead <= 4; ahead++){
+        Chip8 emu(false);
+        emu.init(1);
+        emu.loadProgram(rom.data(), (int)rom.size());
+        auto t0 = chrono::steady_clock::now();
+        for(unsigned long f = 0; f < frames; f++){
+            pongInput(emu, f);
+            emu.runCycles(cpf);
+            if(ahead){
+                emu.saveState(s);
+                emu.runCycles((unsigned long)ahead * cpf);
+                emu.loadState(s, false);
+            }
+        }
+        auto t1 = chrono::steady_clock::now();
+        double ns = chrono::duration<double, nano>(t1 - t0).count() / frames;
+        printf("    { \"frames_ahead\": %d, \"frame_ns\": %.1f, \"core_percent_at_60fps\": %.4f }%s\n",
+               ahead, ns, ns * 60 / 1e7, ahead < 4 ? "," : "");
+    }
+    printf("  ],\n");
+}
+
+// Lockstep batch engine against the same number of Chip8 instances run one
+// after another. "alu" keeps every lane on the same opcode; on Pong each lane
+// has its own seed and an input script shifted by its lane number, so lanes
+// diverge. The batch must leave every lane in the state its Chip8 twin reaches.
+static void benchBatch(const vector<unsigned char>& alu, const vector<unsigned char>& game, unsigned long budget){
+    const unsigned cpf = Chip8::CYCLES_PER_FRAME;
+    const unsigned laneCounts[] = { 64, 1024, 4096 };
+    struct Rom { const char* name; const vector<unsigned char>* rom; bool input; };
+    const Rom roms[] = { { "alu", &alu, false }, { "pong", &game, true } };
+    static Chip8State a, b;
+
+    printf("  \"batch\": {\n");
+    printf("      \"avx2_gather\": %s,\n", Chip8Batch(1).gatherEnabled() ? "true" : "false");
+    printf("      \"runs\": [\n");
+    for(int r = 0; r < 2; r++){
+        for(int c = 0; c < 3; c++){
+            unsigned lanes = laneCounts[c];
+            unsigned long frames = budget / ((unsigned long)lanes * cpf) + 1;
+            const vector<unsigned char>& rom = *roms[r].rom;
+
+            Chip8Batch batch(lanes);
+            batch.init(1);
+            batch.loadProgram(rom.data(), (int)rom.size());
+            vector<Chip8> emus(lanes, Chip8(false));
+            for(unsigned l = 0; l < lanes; l++){
+                emus[l].init(1 + l);
+                emus[l].loadProgram(rom.data(), (int)rom.size());
+            }
+
+            auto t0 = chrono::steady_clock::now();
+            for(unsigned long f = 0; f < frames; f++){
+                if(roms[r].input)
+                    for(unsigned l = 0; l < lanes; l++) batch.setKeys(l, pongKeys(f + l));
+                batch.runCycles(cpf);
+            }
+            auto t1 = chrono::steady_clock::now();
+            for(unsigned long f = 0; f < frames; f++){
+                for(unsigned l = 0; l < lanes; l++){
+                    if(roms[r].input) emus[l].setKeys(pongKeys(f + l));
+                    emus[l].runCycles(cpf);
+                }
+            }
+            auto t2 = chrono::steady_clock::now();
+
+            bool match = true;
+            for(unsigned l = 0; l < lanes && match; l++){
+                batch.saveState(l, a);
+                emus[l].saveState(b);
+                match = !memcmp(&a, &b, sizeof(a));
+            }
+            double instrs = (double)frames * cpf * lanes;
+            double batchMips = instrs / chrono::duration<double, micro>(t1 - t0).count();
+            double scalarMips = instrs / chrono::duration<double, micro>(t2 - t1).count();
+            printf("        { \"rom\": \"%s\", \"lanes\": %u, \"aggregate_mips\": %.1f, \"scalar_mips\": %.1f, "
+                   "\"speedup\": %.2f, \"matches_scalar\": %s }%s\n",
+                   roms[r].name, lanes, batchMips, scalarMips, batchMips / scalarMips, check("batch.matches_scalar", match),
+                   r == 1 && c == 2 ? "" : ",");
+        }
+    }
+    printf("      ]\n");
+    printf("  },\n");
+}
+
+// Vectorized environment on Pong: environment steps per second (frameskip 4,
+// per-env input, score-digit rewards) per engine, shard size and observation
+// format, against the same envs as Chip8 instances stepped in a plain loop.
+// Every observation must equal its Chip8 twin's framebuffer.
+static void benchEnv(const vector<unsigned char>& game, unsigned steps){
+    const unsigned envs = 256, frameskip = 4;
+    struct Run { Chip8VecEnv::Engine engine; unsigned lanes; Chip8VecEnv::ObsFormat obs; };
+    const Run runs[] = {
+        { Chip8VecEnv::LOCKSTEP, 8, Chip8VecEnv::OBS_8BPP }, { Chip8VecEnv::LOCKSTEP, 64, Chip8VecEnv::OBS_8BPP },
+        { Chip8VecEnv::LOCKSTEP, 256, Chip8VecEnv::OBS_8BPP }, { Chip8VecEnv::SCALAR, 64, Chip8VecEnv::OBS_8BPP },
+        { Chip8VecEnv::LOCKSTEP, 256, Chip8VecEnv::OBS_1BPP }, { Chip8VecEnv::SCALAR, 64, Chip8VecEnv::OBS_1BPP },
+    };
+    const size_t count = sizeof(runs) / sizeof(runs[0]);
+    vector<uint16_t> actions(envs);
+    vector<float> rewards(envs);
+    vector<uint8_t> done(envs);
+
+    vector<Chip8> emus(envs, Chip8(false));
+    for(unsigned e = 0; e < envs; e++){
+        emus[e].init(1 + e);
+        emus[e].loadProgram(game.data(), (int)game.size());
+    }
+    auto t0 = chrono::steady_clock::now();
+    for(unsigned s = 0; s < steps; s++){
+        for(unsigned e = 0; e < envs; e++){
+            emus[e].setKeys(pongKeys(s + e));
+            emus[e].runCycles(frameskip * Chip8::CYCLES_PER_FRAME);
+        }
+    }
+    double scalarRate = (double)envs * steps / chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    printf("  \"env\": {\n");
+    printf("      \"envs\": %u, \"frameskip\": %u, \"scalar_steps_per_second\": %.0f,\n", envs, frameskip, scalarRate);
+    printf("      \"runs\": [\n");
+    for(size_t k = 0; k < count; k++){
+        Chip8VecEnv::Config cfg;
+        cfg.frameskip = frameskip;
+        cfg.engine = runs[k].engine;
+        cfg.obs = runs[k].obs;
+        cfg.lanesPerShard = runs[k].lanes;
+        cfg.rules.push_back(Chip8EnvRule{ 0x2F3, Chip8EnvRule::DELTA, 0, 1, false });     // Score digits
+        cfg.rules.push_back(Chip8EnvRule{ 0x2F4, Chip8EnvRule::DELTA, 0, -1, false });
+        Chip8VecEnv env(game.data(), (int)game.size(), envs, cfg);
+        vector<uint8_t> obs(envs * env.obsBytes());
+        env.reset(obs.data());
+
+        auto t1 = chrono::steady_clock::now();
+        for(unsigned s = 0; s < steps; s++){
+            for(unsigned e = 0; e < envs; e++) actions[e] = pongKeys(s + e);
+            env.step(actions.data(), obs.data(), rewards.data(), done.data());
+        }
+        double rate = (double)envs * steps / chrono::duration<double>(chrono::steady_clock::now() - t1).count();
+
+        bool bits = cfg.obs == Chip8VecEnv::OBS_1BPP;
+        bool match = true;
+        for(unsigned e = 0; e < envs && match; e++){
+            const uint8_t* o = &obs[e * env.obsBytes()];
+            const unsigned char* px = emus[e].getGfx();
+            for(unsigned p = 0; p < 2048 && match; p++)
+                match = (bits ? (o[p / 8] >> (7 - p % 8)) & 1 : o[p]) == px[p];
+        }
+        printf("        { \"engine\": \"%s\", \"lanes_per_shard\": %u, \"obs\": \"%s\", \"steps_per_second\": %.0f, "
+               "\"frames_per_second\": %.0f, \"speedup\": %.2f, \"matches_scalar\": %s }%s\n",
+               cfg.engine == Chip8VecEnv::SCALAR ? "scalar" : "lockstep", cfg.lanesPerShard, bits ? "1bpp" : "8bpp",
+               rate, rate * frameskip, rate / scalarRate, check("env.matches_scalar", match), k + 1 < count ? "," : "");
+    }
+    printf("      ]\n");
+    printf("  },\n");
+}
+
+// Hang detector: time spent in check() relative to emulation on a live game,
+// at two check intervals (resetting on every key change, as chip8_farm does),
+// and frames needed to prove that a jump-to-self loop never ends. The check
+// time is measured directly: the difference of two whole runs drowns in noise.
+static void benchHang(const vector<unsigned char>& game, unsigned long frames, int samples){
+    const unsigned cpf = Chip8::CYCLES_PER_FRAME;
+    auto overhead = [&](unsigned long interval){
+        Chip8 emu(false);
+        emu.init(1);
+        emu.loadProgram(game.data(), (int)game.size());
+        Chip8HangDetector hang;
+        unsigned short keys = 0;
+        double runNs = 0, checkNs = 0;
+        for(unsigned long f = 1; f <= frames * samples; f++){
+            if(pongKeys(f) != keys){
+                keys = pongKeys(f);
+                emu.setKeys(keys);
+                hang.reset();
+            }
+            auto t0 = chrono::steady_clock::now();
+            emu.runCycles(cpf);
+            auto t1 = chrono::steady_clock::now();
+            runNs += chrono::duration<double, nano>(t1 - t0).count();
+            if(f % interval == 0){
+                hang.check(emu);
+                checkNs += chrono::duration<double, nano>(chrono::steady_clock::now() - t1).count();
+            }
+        }
+        return 100.0 * checkNs / runNs;
+    };
+
+    RomBuilder spin;
+    spin.op(0x1200);
+    Chip8 emu(false);
+    emu.init(1);
+    emu.loadProgram(spin.bytes.data(), (int)spin.bytes.size());
+    Chip8HangDetector hang;
+    unsigned long f = 0;
+    while(f < 100000){
+        emu.runCycles(cpf);
+        if(++f % 60 == 0 && hang.check(emu)) break;
+    }
+
+    printf("  \"hang\": {\n");
+    printf("      \"overhead_percent_every_60_frames\": %.3f,\n", overhead(60));
+    printf("      \"overhead_percent_every_frame\": %.3f,\n", overhead(1));
+    printf("      \"spin_loop_detected_at_frame\": %lu,\n", f);
+    printf("      \"spin_loop_detected\": %s\n", check("hang.spin_loop_detected", f < 100000));
+    printf("  }\n");
+}
+
+// Execution log capture: MIPS with and without Chip8ExecLogger on the ALU mix
+// and on Pong, log bytes per instruction, then the Pong log is decoded and
+// checked record by record (pc, opcode, V0-VF, I, sp, checkpoint hashes)
+// against a second run of the same input.
+static void benchExecLog(const vector<unsigned char>& alu, const vector<unsigned char>& game,
+                         unsigned long frames, int samples){
+    const unsigned cpf = Chip8::CYCLES_PER_FRAME;
+    string path = (filesystem::temp_directory_path() / "chip8_bench.c8x").string();
+    auto fresh = [](Chip8& emu, const vector<unsigned char>& rom){
+        emu.init(1);
+        emu.loadProgram(rom.data(), (int)rom.size());
+    };
+    struct Result { Stat plain, logged; double bytesPerInstr; bool written; };
+    auto measure = [&](const vector<unsigned char>& rom, bool input){
+        Result r{ {}, {}, 0, true };
+        vector<double> plain, logged;
+        double instrs = (double)frames * cpf;
+        for(int s = 0; s < samples; s++){
+            Chip8 emu(false);
+            fresh(emu, rom);
+            auto t0 = chrono::steady_clock::now();
+            for(unsigned long f = 0; f < frames; f++){
+                if(input) emu.setKeys(pongKeys(f));
+                emu.runCycles(cpf);
+            }
+            plain.push_back(instrs / chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() * 1e3);
+
+            fresh(emu, rom);
+            Chip8ExecLogWriter writer;
+            writer.open(path.c_str());
+            t0 = chrono::steady_clock::now();
+            Chip8ExecLogger log(writer, emu);
+            for(unsigned long f = 0; f < frames; f++){
+                if(input) emu.setKeys(pongKeys(f));
+                emu.runCycles(cpf, log);
+            }
+            log.finish();
+            r.bytesPerInstr = writer.offset() / instrs;
+            r.written = writer.close() && r.written;
+            logged.push_back(instrs / chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() * 1e3);
+        }
+        r.plain = summarize(plain);
+        r.logged = summarize(logged);
+        return r;
+    };
+    Result a = measure(alu, false);
+    Result g = measure(game, true);                 // Leaves the Pong log on disk for the check below
+
+    static Chip8ExecLogReader reader;
+    bool match = reader.open(path.c_str()) && reader.instructions() == (uint64_t)frames * cpf;
+    const auto& index = reader.checkpoints();
+    Chip8 emu(false);
+    fresh(emu, game);
+    Chip8ExecLogRecord r;
+    uint64_t done = 0;
+    size_t nextCheckpoint = 1;
+    match = match && index[0].instruction == 0 && index[0].hash == emu.stateHash();     // Taken before any keys
+    for(unsigned long f = 0; f < frames && match; f++){
+        emu.setKeys(pongKeys(f));
+        for(unsigned c = 0; c < cpf && match; c++, done++){
+            if(nextCheckpoint < index.size() && index[nextCheckpoint].instruction == done)
+                match = index[nextCheckpoint++].hash == emu.stateHash();
+            unsigned short pc = emu.getPC();
+            unsigned short op = (unsigned short)(emu.readMemory(pc) << 8 | emu.readMemory(pc + 1));
+            emu.runCycles(1);
+            match = match && reader.next(r) && r.instruction == done && r.pc == pc && r.opcode == op
+                 && !memcmp(r.reg, emu.getRegisters(), 16) && r.I == emu.getIndex() && r.sp == emu.getStackPointer();
+        }
+    }
+    match = match && !reader.next(r) && !reader.malformed() && nextCheckpoint + 1 == index.size()
+         && index.back().hash == emu.stateHash();
+    filesystem::remove(path);
+
+    printf("  \"exec_log\": {\n");
+    printf("      \"alu_mips\": { \"plain\": %.1f, \"logged\": %.1f, \"ci95\": %.1f },\n",
+           a.plain.mean, a.logged.mean, a.logged.ci95);
+    printf("      \"pong_mips\": { \"plain\": %.1f, \"logged\": %.1f, \"ci95\": %.1f },\n",
+           g.plain.mean, g.logged.mean, g.logged.ci95);
+    printf("      \"alu_bytes_per_instruction\": %.2f,\n", a.bytesPerInstr);
+    printf("      \"pong_bytes_per_instruction\": %.2f,\n", g.bytesPerInstr);
+    printf("      \"buffer_bytes\": %zu,\n", 2 * Chip8ExecLogWriter::BUFFER_BYTES);
+    printf("      \"written\": %s,\n", check("exec_log.written", a.written && g.written));
+    printf("      \"decoded_matches_replay\": %s\n", check("exec_log.decoded_matches_replay", match));
+    printf("  },\n");
+}
+
+// Breakpoints and watchpoints: MIPS of Chip8Watch::run() a frame at a time
+// against plain runCycles() on the ALU mix and on Pong, with nothing set, a
+// memory watch and a breakpoint (both on 0xFFF, which neither program
+// touches). The modes take turns within each sample so drift hits all alike.
+static void benchWatch(const vector<unsigned char>& alu, const vector<unsigned char>& game,
+                       unsigned long frames, int samples){
+    const unsigned cpf = Chip8::CYCLES_PER_FRAME;
+    enum { PLAIN, EMPTY, MEMORY, BREAKPOINT, MODES };
+    static const char* names[MODES] = { "plain", "no_watch", "memory_watch", "breakpoint" };
+    struct Result { Stat mips[MODES]; bool sameState; };
+    auto measure = [&](const vector<unsigned char>& rom, bool input){
+        Result r;
+        r.sameState = true;
+        vector<double> mips[MODES];
+        for(int s = 0; s < samples; s++){
+            uint64_t hash = 0;
+            for(int m = 0; m < MODES; m++){
+                Chip8 emu(false);
+                emu.init(1);
+                emu.loadProgram(rom.data(), (int)rom.size());
+                Chip8Watch watch;
+                if(m == MEMORY) watch.watchMemory(0xFFF, Chip8Watch::READ | Chip8Watch::WRITE);
+                if(m == BREAKPOINT) watch.addBreakpoint(0xFFF);
+                auto t0 = chrono::steady_clock::now();
+                for(unsigned long f = 0; f < frames; f++){
+                    if(input) emu.setKeys(pongKeys(f));
+                    if(m == PLAIN) emu.runCycles(cpf);
+                    else watch.run(emu, cpf);
+                }
+                double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count();
+                mips[m].push_back((double)frames * cpf / ns * 1e3);
+                if(m == PLAIN) hash = emu.stateHash();
+                else r.sameState = r.sameState && emu.stateHash() == hash && watch.hit().reason == Chip8Watch::NONE;
+            }
+        }
+        for(int m = 0; m < MODES; m++) r.mips[m] = summarize(mips[m]);
+        return r;
+    };
+    Result a = measure(alu, false);
+    Result g = measure(game, true);
+
+    printf("  \"watch\": {\n");
+    for(int w = 0; w < 2; w++){
+        const Result& r = w ? g : a;
+        printf("      \"%s_mips\": {", w ? "pong" : "alu");
+        for(int m = 0; m < MODES; m++)
+            printf(" \"%s\": { \"mean\": %.1f, \"ci95\": %.1f }%s", names[m], r.mips[m].mean, r.mips[m].ci95, m + 1 < MODES ? "," : " ");
+        printf("},\n");
+        printf("      \"%s_no_watch_overhead_percent\": %.2f,\n", w ? "pong" : "alu",
+               100.0 * (r.mips[PLAIN].mean / r.mips[EMPTY].mean - 1));
+    }
+    printf("      \"same_state\": %s\n", check("watch.same_state", a.sameState && g.sameState));
+    printf("  },\n");
+}
+
+// Coverage: Pong MIPS with and without Chip8Coverage (alternating within
+// each sample), and what the run reached of the ROM.
+static void benchCoverage(const vector<unsigned char>& game, unsigned long frames, int samples){
+    const unsigned cpf = Chip8::CYCLES_PER_FRAME;
+    vector<double> plain, covered;
+    unique_ptr<Chip8Coverage> cov;
+    for(int s = 0; s < samples; s++){
+        for(int m = 0; m < 2; m++){
+            Chip8 emu(false);
+            emu.init(1);
+            emu.loadProgram(game.data(), (int)game.size());
+            cov.reset(new Chip8Coverage());
+            auto t0 = chrono::steady_clock::now();
+            for(unsigned long f = 0; f < frames; f++){
+                emu.setKeys(pongKeys(f));
+                if(m) emu.runCycles(cpf, *cov);
+                else emu.runCycles(cpf);
+            }
+            double mips = (double)frames * cpf / chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() * 1e3;
+            (m ? covered : plain).push_back(mips);
+        }
+    }
+    unsigned bytes[Chip8Coverage::CLASSES];
+    cov->summarize((unsigned)game.size(), bytes);
+    Stat p = summarize(plain), c = summarize(covered);
+
+    printf("  \"coverage\": {\n");
+    printf("      \"pong_mips\": { \"plain\": %.1f, \"covered\": %.1f, \"ci95\": %.1f },\n", p.mean, c.mean, c.ci95);
+    printf("      \"pong_bytes\": {");
+    for(int k = 0; k < Chip8Coverage::CLASSES; k++)
+        printf(" \"%s\": %u%s", Chip8Coverage::className(k), bytes[k], k + 1 < Chip8Coverage::CLASSES ? "," : " ");
+    printf("}\n");
+    printf("  },\n");
+}
+
+// Guest call-stack profiling: MIPS with and without Chip8FlameProfiler on the
+// ALU mix and on Pong (alternating within each sample). Checks the profiled
+// run ends in the same state and that the folded stacks account for every
+// instruction.
+static void benchFlame(const vector<unsigned char>& alu, const vector<unsigned char>& game,
+                       unsigned long frames, int samples){
+    const unsigned cpf = Chip8::CYCLES_PER_FRAME;
+    struct Result { Stat plain, profiled; bool sameState, allCounted; };
+    auto measure = [&](const vector<unsigned char>& rom, bool input){
+        Result r;
+        r.sameState = r.allCounted = true;
+        vector<double> mips[2];
+        for(int s = 0; s < samples; s++){
+            uint64_t hash = 0;
+            for(int m = 0; m < 2; m++){
+                Chip8 emu(false);
+                emu.init(1);
+                emu.loadProgram(rom.data(), (int)rom.size());
+                unique_ptr<Chip8FlameProfiler> flame(new Chip8FlameProfiler());
+                auto t0 = chrono::steady_clock::now();
+                for(unsigned long f = 0; f < frames; f++){
+                    if(input) emu.setKeys(pongKeys(f));
+                    if(m) emu.runCycles(cpf, *flame);
+                    else emu.runCycles(cpf);
+                }
+                double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count();
+                mips[m].push_back((double)frames * cpf / ns * 1e3);
+                if(!m){
+                    hash = emu.stateHash();
+                    continue;
+                }
+                r.sameState = r.sameState && emu.stateHash() == hash;
+                FILE* folded = tmpfile();
+                if(!folded){
+                    r.allCounted = false;
+                    continue;
+                }
+                flame->writeFolded(folded);
+                rewind(folded);
+                char line[512];
+                unsigned long long total = 0;
+                while(fgets(line, sizeof(line), folded)){
+                    const char* count = strrchr(line, ' ');
+                    if(count) total += strtoull(count + 1, nullptr, 10);
+                }
+                fclose(folded);
+                r.allCounted = r.allCounted && total == (unsigned long long)frames * cpf;
+            }
+        }
+        r.plain = summarize(mips[0]);
+        r.profiled = summarize(mips[1]);
+        return r;
+    };
+    Result a = measure(alu, false);
+    Result g = measure(game, true);
+
+    printf("  \"flame\": {\n");
+    for(int w = 0; w < 2; w++){
+        const Result& r = w ? g : a;
+        printf("      \"%s_mips\": { \"plain\": %.1f, \"profiled\": %.1f, \"ci95\": %.1f },\n",
+               w ? "pong" : "alu", r.plain.mean, r.profiled.mean, r.profiled.ci95);
+        printf("      \"%s_overhead_percent\": %.2f,\n", w ? "pong" : "alu",
+               100.0 * (r.plain.mean / r.profiled.mean - 1));
+    }
+    printf("      \"same_state\": %s,\n", check("flame.same_state", a.sameState && g.sameState));
+    printf("      \"samples_match_instructions\": %s\n",
+           check("flame.samples_match_instructions", a.allCounted && g.allCounted));
+    printf("  },\n");
+}
+
+// Returning an instance to its start: init() + loadROM() (file I/O),
+// init() + loadProgram() from a buffer, and resetTo() a checkpoint after 60
+// and after 600 frames of play. Only the reset itself is timed.
+static void benchReset(const vector<unsigned char>& game, const string& romPath, int samples){
+    const unsigned cpf = Chip8::CYCLES_PER_FRAME;
+    const int rounds = 2000 * samples;
+    Chip8 emu(false);
+    bool fromFile = emu.loadROM(romPath.c_str());
+
+    auto t0 = chrono::steady_clock::now();
+    for(int i = 0; i < rounds; i++){
+        emu.init(1);
+        if(fromFile) emu.loadROM(romPath.c_str());
+        else emu.loadProgram(game.data(), (int)game.size());
+    }
+    auto t1 = chrono::steady_clock::now();
+    for(int i = 0; i < rounds; i++){
+        emu.init(1);
+        emu.loadProgram(game.data(), (int)game.size());
+    }
+    auto t2 = chrono::steady_clock::now();
+    double fileNs = chrono::duration<double, nano>(t1 - t0).count() / rounds;
+    double bufferNs = chrono::duration<double, nano>(t2 - t1).count() / rounds;
+
+    static Chip8State start;
+    emu.checkpoint(start);
+    auto afterPlay = [&](unsigned long frames, bool& match){
+        double ns = 0;
+        match = true;
+        for(int i = 0; i < rounds / 10; i++){
+            for(unsigned long f = 0; f < frames; f++){
+                emu.setKeys(pongKeys(f + i));
+                emu.runCycles(cpf);
+            }
+            auto a = chrono::steady_clock::now();
+            emu.resetTo(start);
+            ns += chrono::duration<double, nano>(chrono::steady_clock::now() - a).count();
+            match = match && emu.matchesState(start) && emu.stateHash() == chip8StateHash(start);
+        }
+        return ns / (rounds / 10);
+    };
+    bool match60, match600;
+    double short60 = afterPlay(60, match60);
+    double long600 = afterPlay(600, match600);
+
+    printf("  \"reset\": {\n");
+    printf("      \"init_load_rom_ns\": %.1f,\n", fileNs);
+    printf("      \"init_load_program_ns\": %.1f,\n", bufferNs);
+    printf("      \"reset_to_after_60_frames_ns\": %.1f,\n", short60);
+    printf("      \"reset_to_after_600_frames_ns\": %.1f,\n", long600);
+    printf("      \"speedup_vs_load_rom\": %.1f,\n", fileNs / long600);
+    printf("      \"matches_checkpoint\": %s\n", check("reset.matches_checkpoint", match60 && match600));
+    printf("  },\n");
+}
+
+// Many instances of one ROM at rest: each plays Pong for a while with its own
+// seed and input, then is parked against the shared start snapshot. Reports
+// resident bytes per parked instance against a live Chip8, the park/unpark
+// cost, and checks every instance comes back with the same state hash. Then
+// the same instances run side by side from share(base): reports their
+// resident bytes and how many still read the shared image.
+static void benchParked(const vector<unsigned char>& game, unsigned instances, unsigned long frames){
+    const unsigned cpf = Chip8::CYCLES_PER_FRAME;
+    static Chip8State base;
+    Chip8 emu(false);
+    emu.init(1);
+    emu.loadProgram(game.data(), (int)game.size());
+    emu.checkpoint(base);
+
+    vector<Chip8Parked> parked(instances);
+    vector<uint64_t> hashes(instances);
+    double parkNs = 0, unparkNs = 0;
+    size_t resident = 0;
+    for(unsigned i = 0; i < instances; i++){
+        emu.resetTo(base);
+        for(unsigned long f = 0; f < frames; f++){
+            emu.setKeys(pongKeys(f + i * 7));
+            emu.runCycles(cpf);
+        }
+        hashes[i] = emu.stateHash();
+        auto t0 = chrono::steady_clock::now();
+        emu.park(parked[i], base);
+        parkNs += chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count();
+        resident += parked[i].residentBytes();
+    }
+    bool match = true;
+    for(unsigned i = instances; i-- > 0; ){
+        auto t0 = chrono::steady_clock::now();
+        emu.unpark(parked[i]);
+        unparkNs += chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count();
+        match = match && emu.stateHash() == hashes[i];
+    }
+
+    vector<Chip8> running(instances, Chip8(false));
+    size_t runningResident = 0;
+    unsigned stillShared = 0;
+    for(unsigned i = 0; i < instances; i++){
+        Chip8& r = running[i];
+        r.share(base);
+        for(unsigned long f = 0; f < frames; f++){
+            r.setKeys(pongKeys(f + i * 7));
+            r.runCycles(cpf);
+        }
+        match = match && r.stateHash() == hashes[i];
+    }
+    for(const Chip8& r : running){
+        runningResident += r.residentBytes();
+        stillShared += r.residentBytes() == sizeof(Chip8);
+    }
+    Chip8 live(false);
+    live.loadState(base, false);
+
+    printf("  \"parked\": {\n");
+    printf("      \"instances\": %u,\n", instances);
+    printf("      \"frames_played\": %lu,\n", frames);
+    printf("      \"live_instance_bytes\": %zu,\n", live.residentBytes());
+    printf("      \"parked_resident_bytes\": %.0f,\n", (double)resident / instances);
+    printf("      \"shared_base_bytes\": %zu,\n", sizeof(Chip8State));
+    printf("      \"park_ns\": %.1f,\n", parkNs / instances);
+    printf("      \"unpark_ns\": %.1f,\n", unparkNs / instances);
+    printf("      \"running_resident_bytes\": %.0f,\n", (double)runningResident / instances);
+    printf("      \"running_still_shared\": %u,\n", stillShared);
+    printf("      \"matches\": %s\n", check("parked.matches", match));
+    printf("  },\n");
+}
+
+// Cxkk-heavy throughput per generator, then aggregate throughput with one
+// instance per thread; per-instance generators should scale linearly
+static void benchRng(unsigned long frames, int samples){
+    const unsigned cpf = Chip8::CYCLES_PER_FRAME;
+    const vector<unsigned char> rom = randomRom();
+    const Chip8Rng::Algorithm algs[] = { Chip8Rng::PCG32, Chip8Rng::XOSHIRO128, Chip8Rng::GLIBC };
+    const char* names[] = { "pcg32", "xoshiro128pp", "glibc" };
+
+    auto runOne = [&](Chip8Rng::Algorithm alg, unsigned long seed){
+        Chip8 emu(false);
+        emu.init(seed, alg);
+        emu.loadProgram(rom.data(), (int)rom.size());
+        emu.runCycles(frames * cpf);
+        return emu.getGfx()[0];
+    };
+
+    printf("  \"rng\": {\n");
+    printf("      \"algorithms\": {\n");
+    for(int a = 0; a < 3; a++){
+        vector<double> mips;
+        for(int s = 0; s < samples; s++){
+            auto t0 = chrono::steady_clock::now();
+            runOne(algs[a], s);
+            auto t1 = chrono::steady_clock::now();
+            mips.push_back(frames * cpf / chrono::duration<double, micro>(t1 - t0).count());
+        }
+        Stat st = summarize(mips);
+        printf("        \"%s\": { \"mips\": { \"mean\": %.4f, \"ci95\": %.4f } }%s\n",
+               names[a], st.mean, st.ci95, a < 2 ? "," : "");
+    }
+    printf("      },\n");
+
+    unsigned hw = thread::hardware_concurrency();
+    if(hw == 0) hw = 1;
+    printf("      \"hardware_threads\": %u,\n", hw);
+    printf("      \"scaling\": [\n");
+    double single = 0;
+    for(unsigned t = 1; ; t *= 2){
+        if(t > hw) t = hw;
+        auto t0 = chrono::steady_clock::now();
+        vector<thread> pool;
+        for(unsigned i = 0; i < t; i++)
+            pool.emplace_back([&, i](){ runOne(Chip8Rng::PCG32, i); });
+        for(auto& th : pool) th.join();
+        auto t1 = chrono::steady_clock::now();
+        double mips = (double)t * frames * cpf / chrono::duration<double, micro>(t1 - t0).count();
+        if(t == 1) single = mips;
+        printf("        { \"threads\": %u, \"aggregate_mips\": %.4f, \"efficiency\": %.3f }%s\n",
+               t, mips, mips / (single * t), t < hw ? "," : "");
+        if(t == hw) break;
+    }
+    printf("      ]\n");
+    printf("  },\n");
+}
+
+int main(int argc, char** argv){
+    int samples = 10;
+    unsigned long frames = 200000;      // Frames per sample
+    string romDir = CHIP8_ROM_DIR;
+
+    for(int i = 1; i < argc; i++){
+        if(!strcmp(argv[i], "--samples") && i + 1 < argc) samples = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--frames") && i + 1 < argc) frames = strtoul(argv[++i], nullptr, 10);
+        else if(!strcmp(argv[i], "--rom-dir") && i + 1 < argc) romDir = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [--samples N] [--frames N] [--rom-dir DIR]\n", argv[0]);
+            return 1;
+        }
+    }
+    if(samples < 1 || frames < 1) return 1;
+
+    vector<Workload> workloads = {
+        { "alu",    aluRom(),    false },
+        { "branch", branchRom(), false },
+        { "draw",   drawRom(),   false },
+        { "memory", memoryRom(), false },
+        { "call",   callRom(),   false },
+    };
+    Workload pong{ "pong", {}, true };
+    if(readFile(romDir + "/Pong.ch8", pong.rom)) workloads.push_back(pong);
+    else fprintf(stderr, "chip8_bench: %s/Pong.ch8 not found, skipping\n", romDir.c_str());
+
+    const unsigned cpf = Chip8::CYCLES_PER_FRAME;
+    PerfCounters perf;
+
+    printf("{\n");
+    printf("  \"benchmark\": \"chip8_bench\",\n");
+    printf("  \"samples\": %d,\n", samples);
+    printf("  \"frames_per_sample\": %lu,\n", frames);
+    printf("  \"cycles_per_frame\": %u,\n", cpf);
+    printf("  \"perf_counters\": {");
+    for(int c = 0; c < PerfCounters::COUNT; c++)
+        printf(" \"%s\": %s%s", PerfCounters::name(c), perf.available(c) ? "true" : "false",
+               c + 1 < PerfCounters::COUNT ? "," : " ");
+    printf("},\n");
+    printf("  \"workloads\": [\n");
+
+    for(size_t w = 0; w < workloads.size(); w++){
+        const Workload& wl = workloads[w];
+        Chip8 emu(false);
+        emu.init();
+        emu.loadProgram(wl.rom.data(), (int)wl.rom.size());
+
+        unsigned long frame = 0;
+        auto runSample = [&](){
+            for(unsigned long f = 0; f < frames; f++, frame++){
+                if(wl.scriptedInput) pongInput(emu, frame);
+                emu.runCycles(cpf);
+            }
+        };
+
+        runSample();                                // Warm-up
+        vector<double> mips, nsPerInstr, fps, ipc, counted;
+        vector<double> perInstr[PerfCounters::COUNT];
+        for(int s = 0; s < samples; s++){
+            auto t0 = chrono::steady_clock::now();
+            perf.start();
+            runSample();
+            perf.stop();
+            auto t1 = chrono::steady_clock::now();
+            double ns = chrono::duration<double, nano>(t1 - t0).count();
+            double instrs = (double)frames * cpf;
+            nsPerInstr.push_back(ns / instrs);
+            mips.push_back(instrs / ns * 1e3);
+            fps.push_back(frames / ns * 1e9);
+            for(int c = 0; c < PerfCounters::COUNT; c++)
+                perInstr[c].push_back(perf.get(c) / instrs);
+            if(perf.get(PerfCounters::CYCLES))
+                ipc.push_back((double)perf.get(PerfCounters::INSTRUCTIONS) / perf.get(PerfCounters::CYCLES));
+            if(perf.anyAvailable()) counted.push_back(100 * perf.running());
+        }
+
+        printf("    {\n");
+        printf("      \"name\": \"%s\",\n", wl.name.c_str());
+        printf("      \"instructions_per_sample\": %lu,\n", frames * cpf);
+        printStat("mips", summarize(mips), false);
+        printStat("ns_per_instruction", summarize(nsPerInstr), false);
+        printPerf(perf, perInstr, ipc, counted);
+        printStat("frames_per_second", summarize(fps), true);
+        printf("    }%s\n", w + 1 < workloads.size() ? "," : "");
+    }
+
+    printf("  ],\n");
+
+    Chip8 emu(false);
+    emu.init();
+    emu.loadProgram(workloads[3].rom.data(), (int)workloads[3].rom.size());     // memory mix
+    emu.runCycles(100 * cpf);
+    benchSaveState(emu, samples);
+    benchStateHash(emu, samples);
+    benchReset(pong.rom.empty() ? workloads[2].rom : pong.rom, romDir + "/Pong.ch8", samples);
+    benchParked(pong.rom.empty() ? workloads[2].rom : pong.rom, 10000, 300);
+    benchRng(frames, samples);
+    const vector<unsigned char>& game = pong.rom.empty() ? workloads[2].rom : workloads.back().rom;
+    benchRewind(game, 36000);
+    benchRunAhead(game, 36000);
+    benchBatch(workloads[0].rom, game, 8 * frames * cpf);
+    benchEnv(game, 2000);
+    benchExecLog(workloads[0].rom, game, frames, samples);
+    benchWatch(workloads[0].rom, game, frames, samples);
+    benchCoverage(game, frames, samples);
+    benchFlame(workloads[0].rom, game, frames, samples);
+    benchHang(game, 36000, samples);
+
+    printf("}\n");
+    for(const string& name : failedChecks) fprintf(stderr, "chip8_bench: check failed: %s\n", name.c_str());
+    return failedChecks.empty() ? 0 : 1;
+}
@@ -0,0 +1,247 @@
+// Time-travel debugger (see chip8_debugger.h). Reads commands from stdin, so
+// it runs interactively or from a script:
+//
+//     s [N]        step N instructions          rs [N]     reverse-step
+//     f [N]        run N frames                 rf [N]     N frames back
+//     c            continue to a breakpoint     rc         reverse-continue
+//     rw ADDR      back to the previous write of ADDR
+//     g N          go to instruction N
+//     b [ADDR]     set a breakpoint (or list all stops)
+//     w WHAT [r|w|rw]  watch a memory byte (hex address), Vx or I; w is the default
+//     d WHAT       delete the breakpoint or watch on WHAT
+//     k MASK       hold keys MASK from here on (discards the recorded future)
+//     r            registers                    x ADDR [N] memory
+//     i            timeline                     q          quit
+//
+// c and rc stop at breakpoints and watchpoints alike (see chip8_watch.h).
+// Input comes from a movie (--movie, which also supplies the seed) or from k.
+// Every command that moves prints the new position and the time it took.
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "chip8.h"
+#include "chip8_debugger.h"
+#include "chip8_execlog.h"
+#include "chip8_watch.h"
+#include "chip8_movie.h"
+
+static int usage(const char* argv0){
+    fprintf(stderr, "usage: %s [--seed S] [--movie m.c8m] [--break ADDR]... [--watch ADDR]... rom.ch8 < commands\n", argv0);
+    return 1;
+}
+
+static void where(const Chip8Debugger& dbg){
+    const Chip8& emu = dbg.machine();
+    unsigned pc = emu.getPC();
+    unsigned op = emu.readMemory(pc) << 8 | emu.readMemory(pc + 1);
+    char text[32];
+    chip8Disassemble(op, text, sizeof(text));
+    printf("@%llu (frame %llu)  PC=0x%03X  OP=0x%04X  %s%s\n", (unsigned long long)dbg.position(),
+           (unsigned long long)(dbg.position() / Chip8::CYCLES_PER_FRAME), pc, op, text,
+           dbg.watch().isBreakpoint(pc) ? "  [break]" : "");
+}
+
+/// Parse a watch target: V0-VF, I, or a hex memory address. Returns false
+/// for memory, with the address in `number`.
+static bool parseRegister(const char* text, unsigned& number){
+    if((text[0] == 'V' || text[0] == 'v') && text[1] && !text[2] && isxdigit((unsigned char)text[1])){
+        number = (unsigned)strtoul(text + 1, nullptr, 16);
+        return true;
+    }
+    if((text[0] == 'I' || text[0] == 'i') && !text[1]){
+        number = Chip8Watch::INDEX;
+        return true;
+    }
+    number = (unsigned)strtoul(text, nullptr, 16) & 0xFFF;
+    return false;
+}
+
+static void registerName(unsigned reg, char* out){
+    if(reg == Chip8Watch::INDEX) snprintf(out, 8, "I");
+    else snprintf(out, 8, "V%X", reg);
+}
+
+static const char* accessName(unsigned access){
+    return access == (Chip8Watch::READ | Chip8Watch::WRITE) ? "rw" : access == Chip8Watch::READ ? "r" : "w";
+}
+
+static void why(const Chip8Watch::Hit& hit){
+    char text[32], reg[8];
+    chip8Disassemble(hit.opcode, text, sizeof(text));
+    switch(hit.reason){
+        case Chip8Watch::BREAKPOINT:
+            printf("breakpoint 0x%03X\n", hit.pc);
+            break;
+        case Chip8Watch::MEMORY_READ:
+        case Chip8Watch::MEMORY_WRITE:
+            printf("%s of [0x%03X] by PC=0x%03X (%s)\n", hit.reason == Chip8Watch::MEMORY_READ ? "read" : "write",
+                   hit.where, hit.pc, text);
+            break;
+        case Chip8Watch::REGISTER_READ:
+        case Chip8Watch::REGISTER_WRITE:
+            registerName(hit.where, reg);
+            printf("%s of %s by PC=0x%03X (%s)\n", hit.reason == Chip8Watch::REGISTER_READ ? "read" : "write",
+                   reg, hit.pc, text);
+            break;
+        case Chip8Watch::NONE:
+            break;
+    }
+}
+
+static void registers(const Chip8Debugger& dbg){
+    const Chip8& emu = dbg.machine();
+    for(unsigned x = 0; x < 16; x++) printf("V%X=%02X%s", x, emu.readRegister(x), x == 7 || x == 15 ? "\n" : " ");
+    printf("I=0x%03X SP=%u keys=%04X\n", emu.getIndex(), emu.getStackPointer(), emu.getKeys());
+}
+
+static void memory(const Chip8Debugger& dbg, unsigned addr, unsigned count){
+    for(unsigned i = 0; i < count; i++){
+        if(i % 16 == 0) printf("%s%03X:", i ? "\n" : "", (addr + i) & 0xFFF);
+        printf(" %02X", dbg.machine().readMemory(addr + i));
+    }
+    printf("\n");
+}
+
+int main(int argc, char** argv){
+    uint64_t seed = 1;
+    const char* moviePath = nullptr;
+    const char* romPath = nullptr;
+    std::vector<unsigned> breaks, watches;
+    for(int i = 1; i < argc; i++){
+        bool more = i + 1 < argc;
+        if(!strcmp(argv[i], "--seed") && more) seed = strtoull(argv[++i], nullptr, 0);
+        else if(!strcmp(argv[i], "--movie") && more) moviePath = argv[++i];
+        else if(!strcmp(argv[i], "--break") && more) breaks.push_back((unsigned)strtoul(argv[++i], nullptr, 16));
+        else if(!strcmp(argv[i], "--watch") && more) watches.push_back((unsigned)strtoul(argv[++i], nullptr, 16));
+        else if(argv[i][0] == '-' || romPath) return usage(argv[0]);
+        else romPath = argv[i];
+    }
+    if(!romPath) return usage(argv[0]);
+
+    Chip8Movie movie;
+    if(moviePath){
+        if(!movie.load(moviePath)){
+            fprintf(stderr, "Cannot read movie %s\n", moviePath);
+            return 1;
+        }
+        seed = movie.seed;
+    }
+    Chip8 emu(false);
+    emu.init(seed, moviePath ? movie.rng : Chip8Rng::PCG32);
+    if(!emu.loadROM(romPath)){
+        fprintf(stderr, "Failed to load ROM %s\n", romPath);
+        return 1;
+    }
+    if(moviePath && Chip8Movie::programHash(emu) != movie.romHash){
+        fprintf(stderr, "Movie was recorded on a different ROM\n");
+        return 1;
+    }
+
+    const unsigned cpf = Chip8::CYCLES_PER_FRAME;
+    static Chip8Debugger dbg(emu);
+    uint64_t end = 216000ull * cpf;                 // Where continue gives up: the movie's end, or an hour
+    if(moviePath){
+        for(const auto& e : movie.events) dbg.setKeys((uint64_t)e.frame * movie.cyclesPerFrame, e.keys);
+        end = (uint64_t)movie.frameCount * movie.cyclesPerFrame;
+    }
+    for(unsigned b : breaks) dbg.watch().addBreakpoint(b);
+    for(unsigned w : watches) dbg.watch().watchMemory(w);
+    where(dbg);
+
+    char line[256];
+    for(;;){
+        printf("(chip8) ");
+        fflush(stdout);
+        if(!fgets(line, sizeof(line), stdin)) break;
+        char cmd[16] = "";
+        char arg1[64] = "", arg2[64] = "";
+        if(sscanf(line, "%15s %63s %63s", cmd, arg1, arg2) < 1) continue;
+        uint64_t n = *arg1 ? strtoull(arg1, nullptr, 0) : 1;
+        unsigned addr = (unsigned)strtoul(arg1, nullptr, 16);
+
+        auto t0 = std::chrono::steady_clock::now();
+        bool moved = true;
+        if(!strcmp(cmd, "s")) dbg.step(n);
+        else if(!strcmp(cmd, "rs")){
+            if(!dbg.reverseStep(n)) printf("at the start\n");
+        }
+        else if(!strcmp(cmd, "f")) dbg.step(n * cpf);
+        else if(!strcmp(cmd, "rf")){
+            if(!dbg.reverseStep(n * cpf)) printf("at the start\n");
+        }
+        else if(!strcmp(cmd, "g")) dbg.seek(strtoull(arg1, nullptr, 0));
+        else if(!strcmp(cmd, "c")){
+            if(dbg.continueForward(end > dbg.position() ? end - dbg.position() : 0)) why(dbg.lastHit());
+            else printf("no stop before the end\n");
+        }
+        else if(!strcmp(cmd, "rc")){
+            if(dbg.reverseContinue()) why(dbg.lastHit());
+            else printf("no earlier stop\n");
+        }
+        else if(!strcmp(cmd, "rw") && *arg1){
+            Chip8Debugger::Write w;
+            if(!dbg.reverseToWrite(addr, w)) printf("no earlier write to 0x%03X\n", addr & 0xFFF);
+            else{
+                char text[32];
+                chip8Disassemble(w.opcode, text, sizeof(text));
+                printf("instruction %llu at PC=0x%03X (%s) wrote [0x%03X]: %02X -> %02X\n",
+                       (unsigned long long)w.instruction, w.pc, text, addr & 0xFFF, w.before, w.after);
+            }
+        }
+        else if(!strcmp(cmd, "k") && *arg1){
+            dbg.setKeys(dbg.position(), (uint16_t)strtoul(arg1, nullptr, 16));
+            if(dbg.position() < end) end = dbg.position() + 216000ull * cpf;
+        }
+        else{
+            moved = false;
+            Chip8Watch& watch = dbg.watch();
+            if(!strcmp(cmd, "b")){
+                if(*arg1) watch.addBreakpoint(addr);
+                else{
+                    char reg[8];
+                    for(unsigned a = 0; a < 4096; a++){
+                        if(watch.isBreakpoint(a)) printf("break 0x%03X\n", a);
+                        if(watch.memoryWatch(a)) printf("watch [0x%03X] %s\n", a, accessName(watch.memoryWatch(a)));
+                    }
+                    for(unsigned r = 0; r <= Chip8Watch::INDEX; r++){
+                        registerName(r, reg);
+                        if(watch.registerWatch(r)) printf("watch %s %s\n", reg, accessName(watch.registerWatch(r)));
+                    }
+                }
+            }
+            else if(!strcmp(cmd, "w") && *arg1){
+                unsigned access = !strcmp(arg2, "r") ? Chip8Watch::READ
+                                : !strcmp(arg2, "rw") ? Chip8Watch::READ | Chip8Watch::WRITE : Chip8Watch::WRITE;
+                unsigned number;
+                if(parseRegister(arg1, number)) watch.watchRegister(number, access);
+                else watch.watchMemory(number, access);
+            }
+            else if(!strcmp(cmd, "d") && *arg1){
+                unsigned number;
+                if(parseRegister(arg1, number)) watch.watchRegister(number, 0);
+                else{
+                    watch.removeBreakpoint(number);
+                    watch.watchMemory(number, 0);
+                }
+            }
+            else if(!strcmp(cmd, "r")) registers(dbg);
+            else if(!strcmp(cmd, "x") && *arg1) memory(dbg, addr, *arg2 ? (unsigned)strtoul(arg2, nullptr, 0) : 16);
+            else if(!strcmp(cmd, "i")){
+                printf("position %llu, furthest %llu, %zu snapshots (every %u instructions), %zu bytes, %zu breakpoints\n",
+                       (unsigned long long)dbg.position(), (unsigned long long)dbg.furthest(), dbg.snapshotCount(),
+                       Chip8Debugger::SNAPSHOT_INTERVAL, dbg.timelineBytes(), dbg.watch().breakpointCount());
+            }
+            else if(!strcmp(cmd, "q")) break;
+            else printf("unknown command %s\n", cmd);
+        }
+        if(moved){
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            where(dbg);
+            printf("  [%.3f ms]\n", ms);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+// Differential runner: drives the reference Chip8 interpreter and a second
+// core (the Chip8Batch lockstep engine) with the same ROM, seed and input,
+// compares their full state every few frames, and on a mismatch steps back
+// through that window to the first instruction after which they disagree and
+// prints a minimal diff.
+// Input comes from a movie (.c8m, which also supplies the seed) or from a
+// seeded pseudo-random key schedule.
+//
+// --inject OPCODE:MASK replaces the second core with a reference core that
+// flips VF after every instruction matching OPCODE under MASK; it checks the
+// runner itself (e.g. --inject 8004:F00F, a broken ADD carry).
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "chip8.h"
+#include "chip8_diff.h"
+#include "chip8_movie.h"
+
+static int usage(const char* argv0){
+    fprintf(stderr, "usage: %s [--frames N] [--every FRAMES] [--seed S] [--movie m.c8m] [--inject OPCODE:MASK] rom.ch8\n", argv0);
+    return 1;
+}
+
+/// Reference core with a planted bug
+struct Chip8InjectedCore : Chip8ReferenceCore {
+    unsigned short pattern = 0, mask = 0;
+    Chip8State scratch;
+
+    struct LastOpcode : Chip8NoHooks {
+        unsigned short op = 0;
+        void onFetch(unsigned short, unsigned short opcode) { op = opcode; }
+    };
+
+    void run(unsigned long cycles){
+        LastOpcode last;
+        for(unsigned long i = 0; i < cycles; i++){
+            emu.runCycles(1, last);
+            if((last.op & mask) != pattern) continue;
+            emu.saveState(scratch, false);
+            scratch.reg[0xF] ^= 1;
+            emu.loadState(scratch, false);
+        }
+    }
+};
+
+struct Input {
+    Chip8Movie movie;
+    bool fromMovie = false;
+    uint64_t seed = 1;
+    size_t next = 0;
+    unsigned long lastFrame = 0;
+    unsigned short keys = 0;
+
+    /// Keypad during frame f. Calls go forward, except that the differ
+    /// rewinds to a checkpoint to step through a window, which restarts the scan
+    unsigned short operator()(unsigned long f){
+        if(f < lastFrame){ next = 0; keys = 0; }
+        lastFrame = f;
+        if(fromMovie){
+            while(next < movie.events.size() && movie.events[next].frame <= f) keys = movie.events[next++].keys;
+            return keys;
+        }
+        // Stateless schedule: a key (or none) per 16-frame block, like a player holding buttons
+        uint64_t h = chip8ZobristMix(seed * 0x9E3779B97F4A7C15ull + f / 16);
+        return (h & 3) == 0 ? 0 : (unsigned short)(1u << (h >> 8) % 16);
+    }
+};
+
+template<class Differ>
+static int report(Differ& differ, const Chip8State& start, unsigned long frames, unsigned long every, Input& input){
+    auto t0 = std::chrono::steady_clock::now();
+    auto d = differ.run(start, frames, every, [&](unsigned long f){ return input(f); });
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    if(!d.found){
+        double mips = differ.instructionsCompared() / (sec > 0 ? sec : 1e-9) / 1e6;
+        double gameplayHours = frames / 60.0 / 3600.0;
+        printf("%lu frames (%llu instructions) match, compared every %lu frames\n",
+               frames, differ.instructionsCompared(), every);
+        printf("%.3f s, %.1f M instructions/s per core pair, %.1f hours of gameplay per minute\n",
+               sec, mips, gameplayHours / (sec > 0 ? sec : 1e-9) * 60);
+        return 0;
+    }
+    printf("divergence at instruction %llu (frame %lu): pc 0x%03X opcode 0x%04X\n",
+           d.instruction, d.frame, d.pc, d.opcode);
+    printf("  field  core A  core B\n");
+    chip8PrintStateDiff(stdout, d.afterA, d.afterB);
+    return 3;
+}
+
+int main(int argc, char** argv){
+    unsigned long frames = 216000, every = 60;          // One hour of play, checked every second
+    const char* moviePath = nullptr;
+    const char* romPath = nullptr;
+    unsigned injectPattern = 0, injectMask = 0;
+    bool inject = false;
+    Input input;
+
+    for(int i = 1; i < argc; i++){
+        bool more = i + 1 < argc;
+        if(!strcmp(argv[i], "--frames") && more) frames = strtoul(argv[++i], nullptr, 10);
+        else if(!strcmp(argv[i], "--every") && more) every = strtoul(argv[++i], nullptr, 10);
+        else if(!strcmp(argv[i], "--seed") && more) input.seed = strtoull(argv[++i], nullptr, 0);
+        else if(!strcmp(argv[i], "--movie") && more) moviePath = argv[++i];
+        else if(!strcmp(argv[i], "--inject") && more){
+            if(sscanf(argv[++i], "%x:%x", &injectPattern, &injectMask) != 2) return usage(argv[0]);
+            inject = true;
+        }
+        else if(argv[i][0] == '-' || romPath) return usage(argv[0]);
+        else romPath = argv[i];
+    }
+    if(!romPath || every == 0) return usage(argv[0]);
+
+    if(moviePath){
+        if(!input.movie.load(moviePath)){
+            fprintf(stderr, "Cannot read movie %s\n", moviePath);
+            return 1;
+        }
+        input.fromMovie = true;
+        input.seed = input.movie.seed;
+        frames = input.movie.frameCount;
+    }
+
+    Chip8 emu(false);
+    emu.init(input.seed, moviePath ? input.movie.rng : Chip8Rng::PCG32);
+    if(!emu.loadROM(romPath)){
+        fprintf(stderr, "Failed to load ROM %s\n", romPath);
+        return 1;
+    }
+    static Chip8State start;
+    emu.saveState(start, false);
+
+    if(inject){
+        static Chip8Differ<Chip8ReferenceCore, Chip8InjectedCore> differ;
+        differ.b.pattern = (unsigned short)injectPattern;
+        differ.b.mask = (unsigned short)injectMask;
+        return report(differ, start, frames, every, input);
+    }
+    static Chip8Differ<Chip8ReferenceCore, Chip8BatchCore> differ;
+    return report(differ, start, frames, every, input);
+}
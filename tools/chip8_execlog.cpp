@@ -0,0 +1,249 @@
+// Execution log recorder and decoder (see chip8_execlog.h).
+//
+//     chip8_execlog record [--frames N] [--seed S] [--movie m.c8m] [--interval N] out.c8x rom.ch8
+//         run headless (input from the movie, else no keys) and log every instruction
+//     chip8_execlog print [--from N] [--count N] log.c8x
+//         one line per instruction: index, pc, opcode, mnemonic, what it changed
+//     chip8_execlog index log.c8x
+//         the checkpoints: instruction, state hash, file offset
+//     chip8_execlog diff [--exact] good.c8x bad.c8x
+//         first instruction where two runs of the same ROM and input split:
+//         bisects the checkpoint state hashes, or with --exact compares every
+//         record (catches differences the state has forgotten by the next checkpoint)
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "chip8.h"
+#include "chip8_execlog.h"
+#include "chip8_movie.h"
+
+static int usage(const char* argv0){
+    fprintf(stderr, "usage: %s record [--frames N] [--seed S] [--movie m.c8m] [--interval N] out.c8x rom.ch8\n"
+                    "       %s print [--from N] [--count N] log.c8x\n"
+                    "       %s index log.c8x\n"
+                    "       %s diff [--exact] good.c8x bad.c8x\n", argv0, argv0, argv0, argv0);
+    return 1;
+}
+
+static int record(int argc, char** argv){
+    unsigned long frames = 3600;
+    uint64_t seed = 1;
+    uint32_t interval = 1u << 16;
+    const char* moviePath = nullptr;
+    const char* paths[2] = { nullptr, nullptr };
+    int positional = 0;
+    for(int i = 2; i < argc; i++){
+        bool more = i + 1 < argc;
+        if(!strcmp(argv[i], "--frames") && more) frames = strtoul(argv[++i], nullptr, 10);
+        else if(!strcmp(argv[i], "--seed") && more) seed = strtoull(argv[++i], nullptr, 0);
+        else if(!strcmp(argv[i], "--movie") && more) moviePath = argv[++i];
+        else if(!strcmp(argv[i], "--interval") && more) interval = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if(argv[i][0] == '-' || positional == 2) return usage(argv[0]);
+        else paths[positional++] = argv[i];
+    }
+    if(positional != 2 || interval == 0) return usage(argv[0]);
+
+    Chip8Movie movie;
+    if(moviePath){
+        if(!movie.load(moviePath)){
+            fprintf(stderr, "Cannot read movie %s\n", moviePath);
+            return 1;
+        }
+        seed = movie.seed;
+        frames = movie.frameCount;
+    }
+    Chip8 emu(false);
+    emu.init(seed, moviePath ? movie.rng : Chip8Rng::PCG32);
+    if(!emu.loadROM(paths[1])){
+        fprintf(stderr, "Failed to load ROM %s\n", paths[1]);
+        return 1;
+    }
+    Chip8MovieSession session(movie, Chip8MovieSession::PLAY);
+    if(moviePath && !session.start(emu)){
+        fprintf(stderr, "Movie was recorded on a different ROM\n");
+        return 1;
+    }
+
+    Chip8ExecLogWriter writer;
+    if(!writer.open(paths[0], interval)){
+        fprintf(stderr, "Cannot write %s\n", paths[0]);
+        return 1;
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    Chip8ExecLogger log(writer, emu);
+    for(unsigned long f = 0; f < frames; f++){
+        if(moviePath) session.frame(emu, 0, log);
+        else emu.runCycles(Chip8::CYCLES_PER_FRAME, log);
+    }
+    log.finish();
+    uint64_t bytes = writer.offset();
+    bool ok = writer.close();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if(!ok){
+        fprintf(stderr, "Write to %s failed\n", paths[0]);
+        return 1;
+    }
+    printf("%lu frames, %llu instructions, %llu bytes (%.2f bytes/instruction), %.3f s, %.1f M instructions/s\n",
+           frames, (unsigned long long)log.instructions(), (unsigned long long)bytes,
+           (double)bytes / (log.instructions() ? log.instructions() : 1), sec,
+           log.instructions() / (sec > 0 ? sec : 1e-9) / 1e6);
+    return 0;
+}
+
+static void printRecord(const Chip8ExecLogRecord& r){
+    char text[32];
+    chip8Disassemble(r.opcode, text, sizeof(text));
+    printf("%10llu  PC=0x%03X  OP=0x%04X  %-18s", (unsigned long long)r.instruction, r.pc, r.opcode, text);
+    for(unsigned m = r.regMask; m; m &= m - 1){
+        unsigned x = chip8LowestBit(m);
+        printf(" V%X=%02X", x, r.reg[x]);
+    }
+    if(r.indexChanged) printf(" I=0x%03X", r.I);
+    if(r.spChanged) printf(" SP=%u", r.sp);
+    if(r.writeCount){
+        printf(" [0x%03X]=", r.writeAddress & 0xFFF);
+        for(unsigned i = 0; i < r.writeCount; i++) printf(i ? " %02X" : "%02X", r.written[i]);
+    }
+    printf("\n");
+}
+
+static int print(int argc, char** argv){
+    unsigned long long from = 0, count = ~0ull;
+    const char* path = nullptr;
+    for(int i = 2; i < argc; i++){
+        bool more = i + 1 < argc;
+        if(!strcmp(argv[i], "--from") && more) from = strtoull(argv[++i], nullptr, 10);
+        else if(!strcmp(argv[i], "--count") && more) count = strtoull(argv[++i], nullptr, 10);
+        else if(argv[i][0] == '-' || path) return usage(argv[0]);
+        else path = argv[i];
+    }
+    if(!path) return usage(argv[0]);
+
+    static Chip8ExecLogReader reader;
+    if(!reader.open(path)){
+        fprintf(stderr, "Cannot read execution log %s\n", path);
+        return 1;
+    }
+    // Start at the last checkpoint at or before `from`
+    const auto& index = reader.checkpoints();
+    size_t k = 0;
+    while(k + 1 < index.size() && index[k + 1].instruction <= from) k++;
+    reader.seek(k);
+
+    Chip8ExecLogRecord r{};
+    unsigned long long shown = 0;
+    while(shown < count && reader.next(r)){
+        if(r.instruction < from) continue;
+        printRecord(r);
+        shown++;
+    }
+    if(reader.malformed()){
+        fprintf(stderr, "Malformed record after instruction %llu\n", (unsigned long long)r.instruction);
+        return 1;
+    }
+    return 0;
+}
+
+static int printIndex(int argc, char** argv){
+    if(argc != 3) return usage(argv[0]);
+    static Chip8ExecLogReader reader;
+    if(!reader.open(argv[2])){
+        fprintf(stderr, "Cannot read execution log %s\n", argv[2]);
+        return 1;
+    }
+    printf("%llu instructions, %zu bytes, checkpoint every %u\n",
+           (unsigned long long)reader.instructions(), reader.bytes(), reader.checkpointInterval());
+    for(const auto& c : reader.checkpoints())
+        printf("%12llu  %016llx  @%llu\n", (unsigned long long)c.instruction,
+               (unsigned long long)c.hash, (unsigned long long)c.offset);
+    return 0;
+}
+
+static void printChanges(const char* label, const Chip8ExecLogRecord& r, unsigned mask){
+    printf("  %s", label);
+    for(unsigned x = 0; x < 16; x++)
+        if(mask >> x & 1) printf(" V%X=%02X", x, r.reg[x]);
+    printf(" I=0x%03X SP=%u", r.I, r.sp);
+    if(r.writeCount){
+        printf(" [0x%03X]=", r.writeAddress & 0xFFF);
+        for(unsigned i = 0; i < r.writeCount; i++) printf(i ? " %02X" : "%02X", r.written[i]);
+    }
+    printf("\n");
+}
+
+static int diff(int argc, char** argv){
+    bool exact = argc == 5 && !strcmp(argv[2], "--exact");
+    if(argc != 4 + exact) return usage(argv[0]);
+    static Chip8ExecLogReader a, b;
+    for(int i = 0; i < 2; i++){
+        if(!(i ? b : a).open(argv[2 + exact + i])){
+            fprintf(stderr, "Cannot read execution log %s\n", argv[2 + exact + i]);
+            return 1;
+        }
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    Chip8ExecLogDivergence d = chip8FindDivergence(a, b, exact);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    printf("A: %llu instructions, B: %llu instructions\n",
+           (unsigned long long)a.instructions(), (unsigned long long)b.instructions());
+    if(d.startDiffers) printf("start states differ (seed or ROM), records compared from the start\n");
+    else printf("%s agree up to instruction %llu\n", exact ? "records" : "state hashes", (unsigned long long)d.agreeUntil);
+    int status = 3;
+    switch(d.kind){
+        case Chip8ExecLogDivergence::NONE:
+            printf(exact ? "runs are identical\n" : "same state at every checkpoint (--exact also compares every record)\n");
+            status = 0;
+            break;
+        case Chip8ExecLogDivergence::LENGTH:
+            printf("runs agree; %s continues after instruction %llu\n",
+                   a.instructions() > b.instructions() ? "A" : "B", (unsigned long long)d.instruction);
+            status = 0;
+            break;
+        case Chip8ExecLogDivergence::STATE:
+            printf("state differs by instruction %llu, but every instruction before it agrees:\n"
+                   "keys, timers or the display differ\n", (unsigned long long)d.instruction);
+            break;
+        case Chip8ExecLogDivergence::INSTRUCTION:{
+            char text[32];
+            chip8Disassemble(d.a.opcode, text, sizeof(text));
+            printf("first divergent instruction %llu (frame %llu): pc 0x%03X opcode 0x%04X %s\n",
+                   (unsigned long long)d.instruction, (unsigned long long)(d.instruction / Chip8::CYCLES_PER_FRAME),
+                   d.a.pc, d.a.opcode, text);
+            if(d.a.pc != d.b.pc || d.a.opcode != d.b.opcode){
+                chip8Disassemble(d.b.opcode, text, sizeof(text));
+                printf("  B ran pc 0x%03X opcode 0x%04X %s instead\n", d.b.pc, d.b.opcode, text);
+            }
+            unsigned mask = d.a.regMask | d.b.regMask;          // Written by either, or already different
+            for(unsigned x = 0; x < 16; x++) if(d.a.reg[x] != d.b.reg[x]) mask |= 1u << x;
+            printChanges("A:", d.a, mask);
+            printChanges("B:", d.b, mask);
+
+            // A few instructions of shared history
+            uint64_t from = d.instruction > 4 ? d.instruction - 4 : 0;
+            const auto& index = a.checkpoints();
+            size_t k = 0;
+            while(k + 1 < index.size() && index[k + 1].instruction <= from) k++;
+            a.seek(k);
+            Chip8ExecLogRecord r;
+            printf("leading up to it (A):\n");
+            while(a.next(r) && r.instruction <= d.instruction)
+                if(r.instruction >= from) printRecord(r);
+            break;
+        }
+    }
+    printf("%llu state hashes compared, %llu records decoded, %.3f ms\n",
+           (unsigned long long)d.hashesCompared, (unsigned long long)d.recordsDecoded, ms);
+    return status;
+}
+
+int main(int argc, char** argv){
+    if(argc < 2) return usage(argv[0]);
+    if(!strcmp(argv[1], "record")) return record(argc, argv);
+    if(!strcmp(argv[1], "print")) return print(argc, argv);
+    if(!strcmp(argv[1], "index")) return printIndex(argc, argv);
+    if(!strcmp(argv[1], "diff")) return diff(argc, argv);
+    return usage(argv[0]);
+}
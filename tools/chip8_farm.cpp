@@ -0,0 +1,287 @@
+// Headless ROM corpus runner. Runs a list of jobs (ROM, quirk profile,
+// frames, input script) across all cores on a work-stealing pool and prints a
+// JSON compatibility/performance report: unknown opcodes, stack faults, hangs,
+// final framebuffer hash and achieved MIPS per job. A job that provably loops
+// forever (see chip8_hang.h) with no scripted input left is stopped early.
+//
+// Job file, one job per line ('#' starts a comment):
+//     ROM PROFILE FRAMES [SCRIPT]
+// ROM is relative to the ROM directory, SCRIPT to the job file. A script is
+// either an input movie (.c8m, which also supplies the seed) or text lines
+// "FRAME KEYS" where KEYS is the keypad mask held from FRAME on.
+// Without a job file every *.ch8 in the directory runs with --frames.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include "chip8.h"
+#include "chip8_hang.h"
+#include "chip8_movie.h"
+#include "chip8_pool.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// The core implements one behaviour set; other profile names are rejected per job
+static const char* const PROFILES[] = { "default" };
+
+struct Job {
+    string rom;
+    string profile = "default";
+    unsigned long frames = 3600;
+    string script;
+};
+
+struct Result {
+    string error;                   // Empty when the job ran
+    unsigned long long instructions = 0;
+    double seconds = 0;
+    Chip8Faults faults;
+    uint64_t gfxHash = 0;
+    unsigned long hangFrame = 0;    // Frame the loop was proven at; 0 = no hang
+    unsigned long long loopInstructions = 0;    // A multiple of the loop's period
+    unsigned worker = 0;
+};
+
+static unsigned long hangCheckFrames = 60;      // Frames between hang checks, 0 = off
+
+static int usage(const char* argv0){
+    fprintf(stderr, "usage: %s [--threads N] [--frames N] [--hang-check FRAMES] [--scaling] [--json FILE] romdir [jobs.txt]\n", argv0);
+    return 1;
+}
+
+static bool readJobs(const string& path, vector<Job>& jobs){
+    FILE* f = fopen(path.c_str(), "r");
+    if(!f) return false;
+    string dir = fs::path(path).parent_path().string();
+    char line[1024];
+    while(fgets(line, sizeof(line), f)){
+        if(char* hash = strchr(line, '#')) *hash = 0;
+        char rom[512], profile[64], script[512] = "";
+        unsigned long frames;
+        int n = sscanf(line, "%511s %63s %lu %511s", rom, profile, &frames, script);
+        if(n < 3) continue;
+        Job job;
+        job.rom = rom;
+        job.profile = profile;
+        job.frames = frames;
+        if(n == 4) job.script = dir.empty() ? string(script) : (fs::path(dir) / script).string();
+        jobs.push_back(job);
+    }
+    fclose(f);
+    return true;
+}
+
+static bool readScript(const string& path, Chip8Movie& movie){
+    if(path.size() > 4 && path.compare(path.size() - 4, 4, ".c8m") == 0) return movie.load(path.c_str());
+    FILE* f = fopen(path.c_str(), "r");
+    if(!f) return false;
+    char line[256];
+    while(fgets(line, sizeof(line), f)){
+        unsigned long frame;
+        long keys;
+        if(line[0] != '#' && sscanf(line, "%lu %li", &frame, &keys) == 2)
+            movie.events.push_back(Chip8MovieEvent{ (uint32_t)frame, (uint16_t)keys, 0 });
+    }
+    fclose(f);
+    stable_sort(movie.events.begin(), movie.events.end(),
+                [](const Chip8MovieEvent& a, const Chip8MovieEvent& b){ return a.frame < b.frame; });
+    return true;
+}
+
+static void runJob(const string& romDir, const Job& job, Result& r){
+    if(find_if(begin(PROFILES), end(PROFILES), [&](const char* p){ return job.profile == p; }) == end(PROFILES)){
+        r.error = "unsupported quirk profile";
+        return;
+    }
+    Chip8Movie movie;
+    movie.seed = 1;
+    if(!job.script.empty() && !readScript(job.script, movie)){
+        r.error = "cannot read input script";
+        return;
+    }
+
+    Chip8 emu(false);
+    emu.init(movie.seed, movie.rng);
+    if(!emu.loadROM((fs::path(romDir) / job.rom).string().c_str())){
+        r.error = "cannot load ROM";
+        return;
+    }
+
+    Chip8HangDetector hang;
+    auto t0 = chrono::steady_clock::now();
+    size_t next = 0;
+    unsigned long f = 0;
+    while(f < job.frames){
+        if(next < movie.events.size() && movie.events[next].frame <= f){
+            while(next < movie.events.size() && movie.events[next].frame <= f) next++;
+            emu.setKeys(movie.events[next - 1].keys);
+            hang.reset();
+        }
+        emu.runCycles(Chip8::CYCLES_PER_FRAME);
+        f++;
+        // A loop only counts once no scripted key press can break it
+        if(hangCheckFrames && f % hangCheckFrames == 0 && hang.check(emu) && next == movie.events.size()){
+            r.hangFrame = f;
+            r.loopInstructions = (unsigned long long)hang.loopChecks() * hangCheckFrames * Chip8::CYCLES_PER_FRAME;
+            break;
+        }
+    }
+    auto t1 = chrono::steady_clock::now();
+
+    r.seconds = chrono::duration<double>(t1 - t0).count();
+    r.instructions = (unsigned long long)f * Chip8::CYCLES_PER_FRAME;
+    r.faults = emu.getFaults();
+    r.gfxHash = chip8Hash(emu.getGfx(), 2048);
+}
+
+// Runs every job once; returns wall-clock seconds
+static double runAll(const string& romDir, const vector<Job>& jobs, vector<Result>& results, Chip8Pool& pool){
+    results.assign(jobs.size(), Result());
+    auto t0 = chrono::steady_clock::now();
+    pool.run(jobs.size(), [&](size_t j, unsigned w){
+        results[j].worker = w;
+        runJob(romDir, jobs[j], results[j]);
+    });
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+// JSON string body: quotes, backslashes (Windows paths) and control characters escaped
+static string jsonEscape(const string& text){
+    string out;
+    for(unsigned char c : text){
+        if(c == '"' || c == '\\'){
+            out += '\\';
+            out += (char)c;
+        }
+        else if(c < 0x20){
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        }
+        else out += (char)c;
+    }
+    return out;
+}
+
+static void writeReport(FILE* out, const vector<Job>& jobs, const vector<Result>& results,
+                        const Chip8Pool& pool, double wall){
+    unsigned long long total = 0;
+    fprintf(out, "{\n");
+    fprintf(out, "  \"threads\": %u,\n", pool.threads());
+    fprintf(out, "  \"jobs\": [\n");
+    for(size_t j = 0; j < jobs.size(); j++){
+        const Job& job = jobs[j];
+        const Result& r = results[j];
+        total += r.instructions;
+        fprintf(out, "    { \"rom\": \"%s\", \"profile\": \"%s\", \"frames\": %lu, ",
+                jsonEscape(job.rom).c_str(), jsonEscape(job.profile).c_str(), job.frames);
+        if(!r.error.empty()){
+            fprintf(out, "\"status\": \"error\", \"error\": \"%s\" }", jsonEscape(r.error).c_str());
+        }
+        else{
+            const Chip8Faults& f = r.faults;
+            bool faulty = f.unknownOpcodes || f.stackOverflows || f.stackUnderflows;
+            fprintf(out, "\"status\": \"%s\", ", r.hangFrame ? "hang" : faulty ? "faults" : "ok");
+            if(r.hangFrame)
+                fprintf(out, "\"hang_frame\": %lu, \"loop_instructions\": %llu, ", r.hangFrame, r.loopInstructions);
+            fprintf(out, "\"unknown_opcodes\": %lu, ", f.unknownOpcodes);
+            if(f.unknownOpcodes)
+                fprintf(out, "\"last_unknown\": { \"opcode\": \"0x%04X\", \"pc\": \"0x%03X\" }, ",
+                        f.lastUnknownOpcode, f.lastUnknownPc);
+            fprintf(out, "\"stack_overflows\": %lu, \"stack_underflows\": %lu, ", f.stackOverflows, f.stackUnderflows);
+            fprintf(out, "\"gfx_hash\": \"%016llx\", \"mips\": %.2f, \"worker\": %u }",
+                    (unsigned long long)r.gfxHash, r.instructions / (r.seconds > 0 ? r.seconds : 1e-9) / 1e6, r.worker);
+        }
+        fprintf(out, "%s\n", j + 1 < jobs.size() ? "," : "");
+    }
+    fprintf(out, "  ],\n");
+    fprintf(out, "  \"wall_seconds\": %.4f,\n", wall);
+    fprintf(out, "  \"aggregate_mips\": %.2f,\n", total / (wall > 0 ? wall : 1e-9) / 1e6);
+    fprintf(out, "  \"steals\": %llu\n", pool.steals());
+    fprintf(out, "}\n");
+}
+
+int main(int argc, char** argv){
+    unsigned threads = 0;
+    unsigned long frames = 3600;
+    bool scaling = false;
+    const char* jsonPath = nullptr;
+    vector<const char*> paths;
+
+    for(int i = 1; i < argc; i++){
+        if(!strcmp(argv[i], "--threads") && i + 1 < argc) threads = (unsigned)atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--frames") && i + 1 < argc) frames = strtoul(argv[++i], nullptr, 10);
+        else if(!strcmp(argv[i], "--hang-check") && i + 1 < argc) hangCheckFrames = strtoul(argv[++i], nullptr, 10);
+        else if(!strcmp(argv[i], "--scaling")) scaling = true;
+        else if(!strcmp(argv[i], "--json") && i + 1 < argc) jsonPath = argv[++i];
+        else if(argv[i][0] == '-') return usage(argv[0]);
+        else paths.push_back(argv[i]);
+    }
+    if(paths.empty() || paths.size() > 2) return usage(argv[0]);
+
+    string romDir = paths[0];
+    vector<Job> jobs;
+    if(paths.size() == 2){
+        if(!readJobs(paths[1], jobs)){
+            fprintf(stderr, "Cannot read job file %s\n", paths[1]);
+            return 1;
+        }
+    }
+    else{
+        error_code ec;
+        for(const auto& entry : fs::directory_iterator(romDir, ec)){
+            if(entry.path().extension() != ".ch8") continue;
+            Job job;
+            job.rom = entry.path().filename().string();
+            job.frames = frames;
+            jobs.push_back(job);
+        }
+        sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b){ return a.rom < b.rom; });
+        if(ec){
+            fprintf(stderr, "Cannot list %s\n", romDir.c_str());
+            return 1;
+        }
+    }
+    if(jobs.empty()){
+        fprintf(stderr, "No jobs\n");
+        return 1;
+    }
+
+    vector<Result> results;
+    if(scaling){
+        // Same job list at 1, 2, 4, ... threads; efficiency = speedup / threads
+        unsigned hw = threads ? threads : thread::hardware_concurrency();
+        if(hw == 0) hw = 1;
+        double single = 0;
+        printf("threads  wall_s  aggregate_mips  efficiency\n");
+        for(unsigned t = 1; ; t *= 2){
+            if(t > hw) t = hw;
+            Chip8Pool pool(t);
+            double wall = runAll(romDir, jobs, results, pool);
+            if(t == 1) single = wall;
+            unsigned long long total = 0;
+            for(const Result& r : results) total += r.instructions;
+            printf("%7u  %6.4f  %14.2f  %10.3f\n", t, wall, total / wall / 1e6, single / (wall * t));
+            if(t == hw) break;
+        }
+        return 0;
+    }
+
+    Chip8Pool pool(threads);
+    double wall = runAll(romDir, jobs, results, pool);
+    FILE* out = jsonPath ? fopen(jsonPath, "w") : stdout;
+    if(!out){
+        fprintf(stderr, "Cannot write %s\n", jsonPath);
+        return 1;
+    }
+    writeReport(out, jobs, results, pool, wall);
+    if(out != stdout) fclose(out);
+    return 0;
+}
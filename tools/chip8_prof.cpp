@@ -0,0 +1,72 @@
+// Headless profiler: runs a ROM for a number of frames and reports where the
+// guest spends its instructions. With --folded it profiles guest call stacks
+// instead and writes flame-graph input.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include "chip8.h"
+#include "chip8_flame.h"
+#include "chip8_profiler.h"
+
+int main(int argc, char** argv){
+    unsigned long frames = 3600;                // One minute of guest time
+    const char* jsonPath = nullptr;
+    const char* foldedPath = nullptr;
+    const char* symbolPath = nullptr;
+    const char* rom = nullptr;
+
+    for(int i = 1; i < argc; i++){
+        if(!strcmp(argv[i], "--frames") && i + 1 < argc) frames = strtoul(argv[++i], nullptr, 10);
+        else if(!strcmp(argv[i], "--json") && i + 1 < argc) jsonPath = argv[++i];
+        else if(!strcmp(argv[i], "--folded") && i + 1 < argc) foldedPath = argv[++i];
+        else if(!strcmp(argv[i], "--symbols") && i + 1 < argc) symbolPath = argv[++i];
+        else if(argv[i][0] != '-' && !rom) rom = argv[i];
+        else rom = nullptr, i = argc;
+    }
+    if(!rom){
+        fprintf(stderr, "usage: %s [--frames N] [--json FILE] [--folded FILE [--symbols FILE]] rom.ch8\n", argv[0]);
+        return 1;
+    }
+
+    Chip8 emu(false);
+    emu.init();
+    if(!emu.loadROM(rom)){
+        fprintf(stderr, "Failed to load ROM %s\n", rom);
+        return 1;
+    }
+
+    if(foldedPath){
+        Chip8FlameProfiler flame;
+        if(symbolPath && !flame.loadSymbols(symbolPath)){
+            fprintf(stderr, "Cannot read symbols %s\n", symbolPath);
+            return 1;
+        }
+        emu.runCycles(frames * Chip8::CYCLES_PER_FRAME, flame);
+
+        FILE* f = fopen(foldedPath, "w");
+        if(!f){
+            fprintf(stderr, "Cannot write %s\n", foldedPath);
+            return 1;
+        }
+        flame.writeFolded(f);
+        fclose(f);
+        return 0;
+    }
+
+    std::unique_ptr<Chip8Profiler> prof(new Chip8Profiler());
+    emu.runCycles(frames * Chip8::CYCLES_PER_FRAME, *prof);
+
+    if(jsonPath){
+        FILE* f = fopen(jsonPath, "w");
+        if(!f){
+            fprintf(stderr, "Cannot write %s\n", jsonPath);
+            return 1;
+        }
+        prof->writeJson(f);
+        fclose(f);
+    }
+    prof->writeHotspots(stdout);
+    return 0;
+}
@@ -0,0 +1,128 @@
+// Headless movie replay: reproduces a recorded run at full speed and checks
+// that the framebuffer sequence matches the recording. --make synthesizes a
+// movie with pseudo-random input for reproducible perf runs. --coverage
+// PREFIX writes which ROM bytes the run executed, drew as sprites or used as
+// data (PREFIX.txt, PREFIX.json) and a heatmap of the 4 KB (PREFIX.ppm).
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include "chip8.h"
+#include "chip8_coverage.h"
+#include "chip8_movie.h"
+
+static int usage(const char* argv0){
+    fprintf(stderr, "usage: %s [--coverage PREFIX] movie.c8m rom.ch8\n"
+                    "       %s --make FRAMES SEED movie.c8m rom.ch8\n", argv0, argv0);
+    return 1;
+}
+
+static long fileSize(const char* path){
+    FILE* f = fopen(path, "rb");
+    if(!f) return -1;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+static bool writeCoverage(const Chip8Coverage& cov, const std::string& prefix, unsigned romSize){
+    const char* exts[3] = { ".txt", ".json", ".ppm" };
+    for(int i = 0; i < 3; i++){
+        std::string path = prefix + exts[i];
+        FILE* f = fopen(path.c_str(), i == 2 ? "wb" : "w");
+        if(!f){
+            fprintf(stderr, "Cannot write %s\n", path.c_str());
+            return false;
+        }
+        bool ok = true;
+        if(i == 0) cov.writeText(f, romSize);
+        else if(i == 1) cov.writeJson(f, romSize);
+        else ok = cov.writePpm(f, romSize);
+        if(fclose(f) != 0 || !ok){
+            fprintf(stderr, "Write to %s failed\n", path.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv){
+    if(argc == 6 && !strcmp(argv[1], "--make")){
+        unsigned long frames = strtoul(argv[2], nullptr, 10);
+        Chip8Movie movie;
+        movie.seed = strtoull(argv[3], nullptr, 0);
+
+        Chip8 emu(false);
+        emu.init(movie.seed, movie.rng);
+        if(!emu.loadROM(argv[5])){
+            fprintf(stderr, "Failed to load ROM %s\n", argv[5]);
+            return 1;
+        }
+        Chip8MovieSession session(movie, Chip8MovieSession::RECORD);
+        session.start(emu);
+        Chip8Rng input;
+        input.seed(movie.seed ^ 0x5EED);
+        uint16_t keys = 0;
+        for(unsigned long f = 0; f < frames; f++){
+            if(input.next() % 20 == 0) keys = (uint16_t)(1u << (input.next() % 16));   // Hold a key for a while
+            if(input.next() % 30 == 0) keys = 0;
+            session.frame(emu, keys);
+        }
+        session.finish();
+        if(!movie.save(argv[4])){
+            fprintf(stderr, "Cannot write %s\n", argv[4]);
+            return 1;
+        }
+        printf("Recorded %u frames, %zu input events\n", movie.frameCount, movie.events.size());
+        return 0;
+    }
+    const char* coveragePrefix = nullptr;
+    if(argc == 5 && !strcmp(argv[1], "--coverage")){
+        coveragePrefix = argv[2];
+        argv += 2;
+        argc -= 2;
+    }
+    if(argc != 3) return usage(argv[0]);
+
+    Chip8Movie movie;
+    if(!movie.load(argv[1])){
+        fprintf(stderr, "Cannot read movie %s\n", argv[1]);
+        return 1;
+    }
+
+    Chip8 emu(false);
+    emu.init(movie.seed, movie.rng);
+    if(!emu.loadROM(argv[2])){
+        fprintf(stderr, "Failed to load ROM %s\n", argv[2]);
+        return 1;
+    }
+    std::unique_ptr<Chip8Coverage> cov;
+    if(coveragePrefix) cov.reset(new Chip8Coverage());
+    Chip8MovieSession session(movie, Chip8MovieSession::PLAY);
+    if(!session.start(emu)){
+        fprintf(stderr, "Movie was recorded on a different ROM\n");
+        return 1;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    if(cov) while(!session.done()) session.frame(emu, 0, *cov);
+    else while(!session.done()) session.frame(emu);
+    auto t1 = std::chrono::steady_clock::now();
+    double sec = std::chrono::duration<double>(t1 - t0).count();
+
+    bool match = session.finish();
+    printf("Replayed %u frames in %.3f s (%.0f frames/s), framebuffer chain %016llx: %s\n",
+           session.frames(), sec, session.frames() / (sec > 0 ? sec : 1e-9),
+           (unsigned long long)session.gfxChain(), match ? "match" : "MISMATCH");
+    if(cov){
+        long size = fileSize(argv[2]);
+        unsigned romSize = size < 0 ? 0 : size > 4096 - 0x200 ? 4096 - 0x200 : (unsigned)size;    // As loadProgram() clamps
+        if(!writeCoverage(*cov, coveragePrefix, romSize)) return 1;
+        cov->writeText(stdout, romSize);
+    }
+    return match ? 0 : 2;
+}
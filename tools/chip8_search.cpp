@@ -0,0 +1,171 @@
+// Headless input search for tool-assisted play: finds a keypad sequence that
+// drives a ROM to a goal (a memory byte or register value, or a framebuffer
+// pattern) with BFS, beam or best-first search over per-step key choices.
+// Expansion runs on every core; see chip8_search.h. A found sequence can be
+// written as an input movie and played back with Emu_CHIP8 --play or
+// chip8_replay.
+//
+// Goals:
+//     mem:ADDR<op>VALUE      e.g. mem:0x2F0>=3
+//     reg:X<op>VALUE         e.g. reg:0xE==1   (op is one of == != < <= > >=)
+//     sprite:X,Y,FILE        FILE rows of '#' (lit) and '.' (dark) at (X, Y)
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "chip8.h"
+#include "chip8_movie.h"
+#include "chip8_search.h"
+
+using namespace std;
+
+static int usage(const char* argv0){
+    fprintf(stderr, "usage: %s --goal GOAL [--mode bfs|beam|best] [--step-frames N] [--beam N]\n"
+                    "          [--max-depth N] [--max-nodes N] [--max-open N] [--threads N] [--actions M,M,...]\n"
+                    "          [--seed S] [--warmup FRAMES] [--movie out.c8m] rom.ch8\n", argv0);
+    return 1;
+}
+
+static bool readSprite(const char* path, Chip8SearchGoal& goal){
+    FILE* f = fopen(path, "r");
+    if(!f) return false;
+    char line[128];
+    while(fgets(line, sizeof(line), f)){
+        size_t n = strcspn(line, "\r\n");
+        if(n == 0) continue;
+        if(goal.width == 0) goal.width = (unsigned)n;
+        if(n != goal.width || n > 64) break;
+        for(size_t c = 0; c < n; c++) goal.pattern.push_back(line[c] == '#');
+        goal.height++;
+    }
+    fclose(f);
+    return goal.width && goal.height && goal.height <= 32 && goal.pattern.size() == goal.width * goal.height;
+}
+
+static bool parseGoal(const char* spec, Chip8SearchGoal& goal){
+    if(!strncmp(spec, "sprite:", 7)){
+        goal.kind = Chip8SearchGoal::SPRITE;
+        char path[512];
+        return sscanf(spec + 7, "%u,%u,%511s", &goal.x, &goal.y, path) == 3 && readSprite(path, goal);
+    }
+    if(!strncmp(spec, "mem:", 4)) goal.kind = Chip8SearchGoal::MEMORY;
+    else if(!strncmp(spec, "reg:", 4)) goal.kind = Chip8SearchGoal::REGISTER;
+    else return false;
+
+    char* rest;
+    goal.address = (unsigned)strtoul(spec + 4, &rest, 0);
+    static const struct { const char* text; Chip8SearchGoal::Compare op; } OPS[] = {
+        { "==", Chip8SearchGoal::EQ }, { "!=", Chip8SearchGoal::NE }, { "<=", Chip8SearchGoal::LE },
+        { ">=", Chip8SearchGoal::GE }, { "<", Chip8SearchGoal::LT }, { ">", Chip8SearchGoal::GT },
+    };
+    for(const auto& op : OPS){
+        size_t n = strlen(op.text);
+        if(strncmp(rest, op.text, n)) continue;
+        goal.compare = op.op;
+        char* end;
+        goal.value = (int)strtol(rest + n, &end, 0);
+        return end != rest + n && *end == 0 &&
+               goal.address < (goal.kind == Chip8SearchGoal::REGISTER ? 16u : 4096u);
+    }
+    return false;
+}
+
+static bool parseActions(const char* list, vector<uint16_t>& actions){
+    while(*list){
+        char* end;
+        unsigned long mask = strtoul(list, &end, 0);
+        if(end == list || mask > 0xFFFF) return false;
+        actions.push_back((uint16_t)mask);
+        list = *end == ',' ? end + 1 : end;
+    }
+    return !actions.empty();
+}
+
+int main(int argc, char** argv){
+    Chip8Search::Options opt;
+    Chip8SearchGoal goal;
+    bool haveGoal = false;
+    uint64_t seed = 1;
+    unsigned long warmup = 0;
+    const char* moviePath = nullptr;
+    const char* romPath = nullptr;
+
+    for(int i = 1; i < argc; i++){
+        bool more = i + 1 < argc;
+        if(!strcmp(argv[i], "--goal") && more){
+            if(!parseGoal(argv[++i], goal)){
+                fprintf(stderr, "Bad goal %s\n", argv[i]);
+                return 1;
+            }
+            haveGoal = true;
+        }
+        else if(!strcmp(argv[i], "--mode") && more){
+            const char* m = argv[++i];
+            if(!strcmp(m, "bfs")) opt.mode = Chip8Search::BFS;
+            else if(!strcmp(m, "beam")) opt.mode = Chip8Search::BEAM;
+            else if(!strcmp(m, "best")) opt.mode = Chip8Search::BEST_FIRST;
+            else return usage(argv[0]);
+        }
+        else if(!strcmp(argv[i], "--step-frames") && more) opt.framesPerStep = (unsigned)strtoul(argv[++i], nullptr, 10);
+        else if(!strcmp(argv[i], "--beam") && more) opt.beamWidth = (unsigned)strtoul(argv[++i], nullptr, 10);
+        else if(!strcmp(argv[i], "--max-depth") && more) opt.maxDepth = (unsigned)strtoul(argv[++i], nullptr, 10);
+        else if(!strcmp(argv[i], "--max-nodes") && more) opt.maxExpanded = strtoull(argv[++i], nullptr, 10);
+        else if(!strcmp(argv[i], "--max-open") && more) opt.maxOpen = strtoull(argv[++i], nullptr, 10);
+        else if(!strcmp(argv[i], "--threads") && more) opt.threads = (unsigned)atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--actions") && more){
+            if(!parseActions(argv[++i], opt.actions)) return usage(argv[0]);
+        }
+        else if(!strcmp(argv[i], "--seed") && more) seed = strtoull(argv[++i], nullptr, 0);
+        else if(!strcmp(argv[i], "--warmup") && more) warmup = strtoul(argv[++i], nullptr, 10);
+        else if(!strcmp(argv[i], "--movie") && more) moviePath = argv[++i];
+        else if(argv[i][0] == '-' || romPath) return usage(argv[0]);
+        else romPath = argv[i];
+    }
+    if(!haveGoal || !romPath || opt.framesPerStep == 0 || opt.beamWidth == 0 || opt.maxOpen == 0) return usage(argv[0]);
+
+    Chip8 emu(false);
+    emu.init(seed);
+    if(!emu.loadROM(romPath)){
+        fprintf(stderr, "Failed to load ROM %s\n", romPath);
+        return 1;
+    }
+    Chip8 start(false);                                 // Untouched copy for the movie
+    Chip8State s;
+    emu.saveState(s, false);
+    start.loadState(s, false);
+    for(unsigned long f = 0; f < warmup; f++) emu.runCycles(Chip8::CYCLES_PER_FRAME);
+
+    Chip8Search::Result r = Chip8Search::run(emu, goal, opt);
+
+    printf("expanded %llu nodes, generated %llu, duplicates %llu, %.3f s, %.0f nodes/s\n",
+           r.expanded, r.generated, r.duplicates, r.seconds, r.nodesPerSecond());
+    if(r.kept)
+        printf("kept %llu snapshots, %.0f bytes each (full snapshot %zu)\n",
+               r.kept, (double)r.keptBytes / r.kept, sizeof(Chip8State));
+    if(!r.found){
+        printf("goal not reached\n");
+        return 2;
+    }
+    printf("goal reached after %zu steps (%lu frames):", r.path.size(), warmup + r.path.size() * opt.framesPerStep);
+    for(uint16_t keys : r.path) printf(" %04X", keys);
+    printf("\n");
+
+    if(moviePath){
+        Chip8Movie movie;
+        movie.seed = seed;
+        Chip8MovieSession session(movie, Chip8MovieSession::RECORD);
+        session.start(start);
+        for(unsigned long f = 0; f < warmup; f++) session.frame(start, 0);
+        for(uint16_t keys : r.path)
+            for(unsigned f = 0; f < opt.framesPerStep; f++) session.frame(start, keys);
+        session.finish();
+        if(!goal.reached(start)) fprintf(stderr, "Warning: replaying the path misses the goal\n");
+        if(!movie.save(moviePath)){
+            fprintf(stderr, "Cannot write %s\n", moviePath);
+            return 1;
+        }
+        printf("wrote %s (%u frames)\n", moviePath, movie.frameCount);
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+// Hardware performance counters for the benchmark harness.
+// Uses Linux perf_event_open; on other platforms, or when the kernel refuses
+// (containers, perf_event_paranoid), every counter reports as unavailable.
+// The counters are opened as one group under the first that opens, so they
+// are scheduled on the PMU together and their ratios (IPC) come from the same
+// time window. When the kernel multiplexes the group with other events, the
+// values are scaled up by time enabled / time running, and running() says
+// how much of the window was actually counted.
+
+#pragma once
+
+#include <cstdint>
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+class PerfCounters {
+    public:
+        enum Counter { CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, COUNT };
+
+        static const char* name(int c){
+            static const char* names[COUNT] = { "cycles", "instructions", "branch_misses", "l1d_misses" };
+            return names[c];
+        }
+
+        PerfCounters(){
+            for(int c = 0; c < COUNT; c++){
+                fd[c] = -1;
+                value[c] = 0;
+            }
+#ifdef __linux__
+            open(CYCLES,        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+            open(INSTRUCTIONS,  PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+            open(BRANCH_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+            open(L1D_MISSES,    PERF_TYPE_HW_CACHE,
+                                PERF_COUNT_HW_CACHE_L1D |
+                                (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+#endif
+        }
+
+        ~PerfCounters(){
+#ifdef __linux__
+            for(int c = COUNT - 1; c >= 0; c--)     // Members before the leader
+                if(fd[c] >= 0) close(fd[c]);
+#endif
+        }
+
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+        bool available(int c) const { return fd[c] >= 0; }
+        bool anyAvailable() const { return leader >= 0; }
+
+        /// Reset and start the group
+        void start(){
+#ifdef __linux__
+            if(leader < 0) return;
+            ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+        }
+
+        /// Stop counting and latch the values read by get(), scaled to the
+        /// whole window if the group was multiplexed
+        void stop(){
+#ifdef __linux__
+            if(leader < 0) return;
+            ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+            uint64_t data[3 + COUNT] = {};          // nr, time enabled, time running, values in open order
+            ssize_t got = read(leader, data, sizeof(data));
+            uint64_t enabled = data[1], ran = data[2];
+            fraction = enabled ? (double)ran / enabled : 0;
+            for(int c = 0; c < COUNT; c++){
+                value[c] = 0;
+                if(fd[c] < 0 || got < (ssize_t)((3 + slot[c] + 1) * sizeof(uint64_t)) || !ran) continue;
+                uint64_t v = data[3 + slot[c]];
+                value[c] = ran < enabled ? (uint64_t)((double)v * enabled / ran) : v;
+            }
+#endif
+        }
+
+        uint64_t get(int c) const { return value[c]; }
+
+        /// Share of the last start()-stop() window the group was counting:
+        /// 1 unless the kernel multiplexed it, 0 if it never got on the PMU
+        double running() const { return fraction; }
+
+    private:
+        int fd[COUNT];
+        uint64_t value[COUNT];
+        int leader = -1;                            // fd of the group leader
+        int slot[COUNT] = {};                       // Position in the group read
+        int members = 0;
+        double fraction = 0;
+
+#ifdef __linux__
+        void open(int c, uint32_t type, uint64_t config){
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = config;
+            attr.disabled = leader < 0;             // Members follow the leader
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fd[c] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+            if(fd[c] < 0) return;
+            if(leader < 0) leader = fd[c];
+            slot[c] = members++;
+        }
+#endif
+};